@@ -42,8 +42,15 @@ func GetPackage() *denv.Package {
 	maintest.AddDependencies(cunittestpkg.GetMainLib()...)
 	maintest.AddDependency(testlib)
 
+	// benchmark application, synthetic graphs for declaration, compile and execute
+	benchapp := denv.SetupCppAppProject(mainpkg, name+"_bench", "bench")
+	benchapp.AddDependencies(cbasepkg.GetMainLib()...)
+	benchapp.AddDependencies(callocpkg.GetMainLib()...)
+	benchapp.AddDependency(mainlib)
+
 	mainpkg.AddMainLib(mainlib)
 	mainpkg.AddTestLib(testlib)
 	mainpkg.AddUnittest(maintest)
+	mainpkg.AddMainApp(benchapp)
 	return mainpkg
 }
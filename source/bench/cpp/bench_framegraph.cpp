@@ -0,0 +1,401 @@
+#include "ccore/c_target.h"
+#include "ccore/c_callback.h"
+#include "cbase/c_base.h"
+#include "cbase/c_context.h"
+#include "cframegraph/c_framegraph.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace ncore
+{
+    using namespace nframegraph;
+
+    // --------------------------------------------------------------------------------------------
+    // --------------------------------------------------------------------------------------------
+    // Backend objects and callbacks that do nothing, we only measure the frame graph itself
+
+    struct GfxTexture
+    {
+        s32 ref_count;
+    };
+
+    struct GfxTextureDescr
+    {
+        s32 ref_count;
+    };
+
+    struct GfxBuffer
+    {
+        s32 ref_count;
+    };
+
+    struct GfxBufferDescr
+    {
+        s32 ref_count;
+    };
+
+    struct GfxRenderContext
+    {
+        s32 ref_count;
+    };
+
+    static void noopCreateTexture(GfxRenderContext* ctxt, GfxTexture* texture, GfxTextureDescr* descr) {}
+    static void noopDestroyTexture(GfxRenderContext* ctxt, GfxTexture* texture) {}
+    static void noopCreateBuffer(GfxRenderContext* ctxt, GfxBuffer* buffer, GfxBufferDescr* descr) {}
+    static void noopDestroyBuffer(GfxRenderContext* ctxt, GfxBuffer* buffer) {}
+    static void noopExecute(Fg* fg, GfxRenderContext* ctxt) {}
+
+    // --------------------------------------------------------------------------------------------
+    // --------------------------------------------------------------------------------------------
+    // Synthetic graphs: a random DAG that is generated once as a list of operations and then
+    // replayed every iteration, so that only the frame graph calls are measured.
+
+    struct BenchConfig
+    {
+        const char* m_name;
+        s32         m_passes;
+        s32         m_resources; // resources created per pass
+        s32         m_fan_in;    // resources read per pass
+        s32         m_buffers;   // percentage of the resources that are buffers
+        s32         m_culled;    // percentage of the passes whose output nobody reads
+    };
+
+    enum EBenchOp
+    {
+        OpOpenPass,
+        OpFinalPass,
+        OpClosePass,
+        OpCreateTexture,
+        OpCreateBuffer,
+        OpReadTexture,
+        OpReadBuffer,
+    };
+
+    struct BenchOp
+    {
+        s32 m_op;
+        s32 m_handle; // index into the handle array of its kind
+    };
+
+    struct BenchRandom
+    {
+        u64 m_state;
+        u32 next()
+        {
+            m_state ^= m_state << 13;
+            m_state ^= m_state >> 7;
+            m_state ^= m_state << 17;
+            return (u32)(m_state >> 16);
+        }
+        s32 range(s32 n) { return n > 0 ? (s32)(next() % (u32)n) : 0; }
+    };
+
+    struct BenchGraph
+    {
+        alloc_t* m_allocator;
+        BenchOp* m_ops;
+        s32      m_op_count;
+        s32      m_pass_count;
+        s32      m_texture_count;
+        s32      m_buffer_count;
+        s32      m_read_count;
+
+        FgTexture*       m_textures;
+        FgBuffer*        m_buffers;
+        GfxTexture*      m_texture_objects;
+        GfxTextureDescr* m_texture_descrs;
+        GfxBuffer*       m_buffer_objects;
+        GfxBufferDescr*  m_buffer_descrs;
+
+        void generate(alloc_t* allocator, BenchConfig const& config, u64 seed)
+        {
+            m_allocator = allocator;
+
+            s32 const max_resources = config.m_passes * config.m_resources;
+            s32 const max_ops       = 3 * config.m_passes + max_resources * 2 + config.m_passes * config.m_fan_in;
+            m_pass_count            = config.m_passes;
+
+            m_ops             = g_allocate_array_and_clear<BenchOp>(allocator, max_ops);
+            m_textures        = g_allocate_array_and_clear<FgTexture>(allocator, max_resources);
+            m_buffers         = g_allocate_array_and_clear<FgBuffer>(allocator, max_resources);
+            m_texture_objects = g_allocate_array_and_clear<GfxTexture>(allocator, max_resources);
+            m_texture_descrs  = g_allocate_array_and_clear<GfxTextureDescr>(allocator, max_resources);
+            m_buffer_objects  = g_allocate_array_and_clear<GfxBuffer>(allocator, max_resources);
+            m_buffer_descrs   = g_allocate_array_and_clear<GfxBufferDescr>(allocator, max_resources);
+
+            // The outputs of live passes that can be read by later passes, encoded as (handle << 1) | is_buffer
+            s32* candidates      = g_allocate_array_and_clear<s32>(allocator, max_resources);
+            u8*  consumed        = g_allocate_array_and_clear<u8>(allocator, max_resources);
+            s32  candidate_count = 0;
+
+            BenchRandom rnd = {seed | 1};
+            m_op_count      = 0;
+            m_texture_count = 0;
+            m_buffer_count  = 0;
+            m_read_count    = 0;
+
+            for (s32 p = 0; p < config.m_passes - 1; ++p)
+            {
+                bool const culled = rnd.range(100) < config.m_culled;
+                m_ops[m_op_count++] = {OpOpenPass, p};
+
+                s32 const fan_in = candidate_count < config.m_fan_in ? candidate_count : config.m_fan_in;
+                s32 const first  = candidate_count - fan_in;
+                for (s32 r = 0; r < fan_in; ++r)
+                {
+                    // Mostly the most recent outputs, sometimes an older one
+                    s32 const c         = (rnd.range(4) == 0) ? rnd.range(first + 1) : first + r;
+                    consumed[c]         = 1;
+                    m_ops[m_op_count++] = {(candidates[c] & 1) ? OpReadBuffer : OpReadTexture, candidates[c] >> 1};
+                    m_read_count++;
+                }
+
+                for (s32 r = 0; r < config.m_resources; ++r)
+                {
+                    bool const buffer = rnd.range(100) < config.m_buffers;
+                    s32 const  handle = buffer ? m_buffer_count++ : m_texture_count++;
+                    m_ops[m_op_count++] = {buffer ? OpCreateBuffer : OpCreateTexture, handle};
+                    if (!culled)
+                    {
+                        consumed[candidate_count]     = 0;
+                        candidates[candidate_count++] = (handle << 1) | (buffer ? 1 : 0);
+                    }
+                }
+                m_ops[m_op_count++] = {OpClosePass, p};
+            }
+
+            // The final pass reads every output of a live pass that nobody read, so only the passes
+            // that were chosen to be culled are culled
+            m_ops[m_op_count++] = {OpFinalPass, config.m_passes - 1};
+            for (s32 c = 0; c < candidate_count; ++c)
+            {
+                if (consumed[c] != 0)
+                    continue;
+                m_ops[m_op_count++] = {(candidates[c] & 1) ? OpReadBuffer : OpReadTexture, candidates[c] >> 1};
+                m_read_count++;
+            }
+            m_ops[m_op_count++] = {OpClosePass, config.m_passes - 1};
+
+            g_deallocate_array(allocator, consumed);
+            g_deallocate_array(allocator, candidates);
+        }
+
+        void declare(Fg* fg)
+        {
+            for (s32 i = 0; i < m_op_count; ++i)
+            {
+                BenchOp const& op = m_ops[i];
+                switch (op.m_op)
+                {
+                    case OpOpenPass: fg_open_pass(fg, "pass", FgExecuteFn(noopExecute)); break;
+                    case OpFinalPass: fg_final_pass(fg, "final", FgExecuteFn(noopExecute)); break;
+                    case OpClosePass: fg_close_pass(fg); break;
+                    case OpCreateTexture: m_textures[op.m_handle] = fg_write(fg, fg_create(fg, "texture", &m_texture_objects[op.m_handle], &m_texture_descrs[op.m_handle])); break;
+                    case OpCreateBuffer: m_buffers[op.m_handle] = fg_write(fg, fg_create(fg, "buffer", &m_buffer_objects[op.m_handle], &m_buffer_descrs[op.m_handle])); break;
+                    case OpReadTexture: fg_read(fg, m_textures[op.m_handle]); break;
+                    case OpReadBuffer: fg_read(fg, m_buffers[op.m_handle]); break;
+                }
+            }
+        }
+
+        void release()
+        {
+            g_deallocate_array(m_allocator, m_ops);
+            g_deallocate_array(m_allocator, m_textures);
+            g_deallocate_array(m_allocator, m_buffers);
+            g_deallocate_array(m_allocator, m_texture_objects);
+            g_deallocate_array(m_allocator, m_texture_descrs);
+            g_deallocate_array(m_allocator, m_buffer_objects);
+            g_deallocate_array(m_allocator, m_buffer_descrs);
+        }
+    };
+
+    // --------------------------------------------------------------------------------------------
+    // --------------------------------------------------------------------------------------------
+
+    struct BenchResult
+    {
+        f64 m_declare_ns;
+        f64 m_compile_ns;
+        f64 m_execute_ns;
+    };
+
+    static f64 s_now_ns()
+    {
+        using namespace std::chrono;
+        return (f64)duration_cast<nanoseconds>(high_resolution_clock::now().time_since_epoch()).count();
+    }
+
+    static Fg* s_setup(alloc_t* allocator, BenchGraph& graph)
+    {
+        u32 const resource_capacity = (u32)(graph.m_texture_count > graph.m_buffer_count ? graph.m_texture_count : graph.m_buffer_count) + (u32)graph.m_read_count + 16;
+        u32 const pass_capacity     = (u32)graph.m_pass_count + 16;
+
+        Fg* fg = fg_setup(allocator, resource_capacity > 0xFFF0 ? 0xFFF0 : resource_capacity, pass_capacity);
+        fg_set_create_texture(fg, callback_t<void, GfxRenderContext*, GfxTexture*, GfxTextureDescr*>(noopCreateTexture));
+        fg_set_destroy_texture(fg, callback_t<void, GfxRenderContext*, GfxTexture*>(noopDestroyTexture));
+        fg_set_create_buffer(fg, callback_t<void, GfxRenderContext*, GfxBuffer*, GfxBufferDescr*>(noopCreateBuffer));
+        fg_set_destroy_buffer(fg, callback_t<void, GfxRenderContext*, GfxBuffer*>(noopDestroyBuffer));
+        return fg;
+    }
+
+    // Best of 'iterations' frames, measured on a graph that is reset and reused every frame. A cold run sets up a new
+    // graph every frame, fg_compile then cannot reuse the results of the previous frame.
+    static BenchResult s_run(alloc_t* allocator, BenchGraph& graph, s32 iterations, bool cold)
+    {
+        GfxRenderContext ctxt;
+        Fg*              fg = s_setup(allocator, graph);
+
+        BenchResult best = {1e30, 1e30, 1e30};
+        for (s32 i = 0; i < iterations; ++i)
+        {
+            if (cold)
+            {
+                fg_teardown(fg);
+                fg = s_setup(allocator, graph);
+            }
+            fg_reset(fg);
+
+            f64 const t0 = s_now_ns();
+            graph.declare(fg);
+            f64 const t1 = s_now_ns();
+            fg_compile(fg, allocator);
+            f64 const t2 = s_now_ns();
+            fg_execute(fg, &ctxt);
+            f64 const t3 = s_now_ns();
+
+            best.m_declare_ns = (t1 - t0) < best.m_declare_ns ? (t1 - t0) : best.m_declare_ns;
+            best.m_compile_ns = (t2 - t1) < best.m_compile_ns ? (t2 - t1) : best.m_compile_ns;
+            best.m_execute_ns = (t3 - t2) < best.m_execute_ns ? (t3 - t2) : best.m_execute_ns;
+        }
+
+        fg_teardown(fg);
+        return best;
+    }
+
+    // One pass that reads 'count' buffers made by an earlier pass, the cost of the access checks of fg_read per access
+    static f64 s_run_access(alloc_t* allocator, s32 count, s32 iterations)
+    {
+        GfxBuffer*      objects = g_allocate_array_and_clear<GfxBuffer>(allocator, count);
+        GfxBufferDescr* descrs  = g_allocate_array_and_clear<GfxBufferDescr>(allocator, count);
+        FgBuffer*       handles = g_allocate_array_and_clear<FgBuffer>(allocator, count);
+        Fg*             fg      = fg_setup(allocator, (u32)count + 16, 16);
+
+        f64 best = 1e30;
+        for (s32 i = 0; i < iterations; ++i)
+        {
+            fg_reset(fg);
+            fg_open_pass(fg, "producer", FgExecuteFn(noopExecute));
+            for (s32 j = 0; j < count; ++j)
+                handles[j] = fg_write(fg, fg_create(fg, "buffer", &objects[j], &descrs[j]));
+            fg_close_pass(fg);
+
+            f64 const t0 = s_now_ns();
+            fg_final_pass(fg, "consumer", FgExecuteFn(noopExecute));
+            for (s32 j = 0; j < count; ++j)
+                fg_read(fg, handles[j]);
+            fg_close_pass(fg);
+            f64 const t1 = s_now_ns();
+
+            best = (t1 - t0) < best ? (t1 - t0) : best;
+        }
+
+        fg_teardown(fg);
+        g_deallocate_array(allocator, handles);
+        g_deallocate_array(allocator, descrs);
+        g_deallocate_array(allocator, objects);
+        return best / (f64)count;
+    }
+
+    static const s32 s_access_counts[] = {64, 256, 1024, 4096};
+
+    static const BenchConfig s_configs[] = {
+      {"small", 64, 4, 2, 30, 10},
+      {"medium", 400, 8, 4, 30, 10},
+      {"large", 1000, 16, 8, 50, 20},
+      {"fanin_8", 64, 1, 8, 50, 0},
+      {"fanin_32", 64, 1, 32, 50, 0},
+      {"fanin_128", 256, 1, 128, 50, 0},
+    };
+
+} // namespace ncore
+
+using namespace ncore;
+
+// Usage: cframegraph_bench [--json] [--cold] [--access] [--iterations N]
+//   --json        one JSON object per configuration (for tracking regressions between versions)
+//   --cold        a new graph every frame, measures the full compile instead of the reuse of the previous frame
+//   --access      the microbenchmark of the per-access checks of fg_read, one pass that reads N buffers
+//   --iterations  the number of frames per configuration, the best frame is reported
+int main(int argc, char** argv)
+{
+    bool json       = false;
+    bool cold       = false;
+    bool access     = false;
+    s32  iterations = 50;
+    for (s32 i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--json") == 0)
+            json = true;
+        else if (strcmp(argv[i], "--cold") == 0)
+            cold = true;
+        else if (strcmp(argv[i], "--access") == 0)
+            access = true;
+        else if (strcmp(argv[i], "--iterations") == 0 && (i + 1) < argc)
+            iterations = atoi(argv[++i]);
+    }
+
+    cbase::init();
+    alloc_t* allocator = context_t::system_alloc();
+
+    if (access)
+    {
+        if (!json)
+            printf("%-10s %12s\n", "reads", "ns/access");
+        for (u32 c = 0; c < sizeof(s_access_counts) / sizeof(s_access_counts[0]); ++c)
+        {
+            f64 const ns = s_run_access(allocator, s_access_counts[c], iterations);
+            if (json)
+                printf("{\"bench\":\"access\",\"reads\":%d,\"ns_per_access\":%.2f}\n", s_access_counts[c], ns);
+            else
+                printf("%-10d %12.1f\n", s_access_counts[c], ns);
+        }
+        cbase::exit();
+        return 0;
+    }
+
+    if (!json)
+        printf("%-10s %6s %8s | %12s %12s | %12s %12s | %12s %12s\n", "graph", "passes", "versions", "declare/pass", "declare/res", "compile/pass", "compile/res", "execute/pass", "execute/res");
+
+    for (u32 c = 0; c < sizeof(s_configs) / sizeof(s_configs[0]); ++c)
+    {
+        BenchConfig const& config = s_configs[c];
+
+        BenchGraph graph;
+        graph.generate(allocator, config, 0x9E3779B97F4A7C15ull + c);
+        BenchResult const result = s_run(allocator, graph, iterations, cold);
+
+        f64 const passes   = (f64)config.m_passes;
+        f64 const versions = (f64)(graph.m_texture_count + graph.m_buffer_count);
+        if (json)
+        {
+            printf("{\"graph\":\"%s\",\"passes\":%d,\"resources_per_pass\":%d,\"fan_in\":%d,\"buffer_pct\":%d,\"culled_pct\":%d,\"versions\":%d,\"reads\":%d,"
+                   "\"declare_ns_per_pass\":%.2f,\"declare_ns_per_resource\":%.2f,\"compile_ns_per_pass\":%.2f,\"compile_ns_per_resource\":%.2f,\"execute_ns_per_pass\":%.2f,\"execute_ns_per_resource\":%.2f}\n",
+                   config.m_name, config.m_passes, config.m_resources, config.m_fan_in, config.m_buffers, config.m_culled, (s32)versions, graph.m_read_count, result.m_declare_ns / passes, result.m_declare_ns / versions, result.m_compile_ns / passes,
+                   result.m_compile_ns / versions, result.m_execute_ns / passes, result.m_execute_ns / versions);
+        }
+        else
+        {
+            printf("%-10s %6d %8d | %12.1f %12.1f | %12.1f %12.1f | %12.1f %12.1f\n", config.m_name, config.m_passes, (s32)versions, result.m_declare_ns / passes, result.m_declare_ns / versions, result.m_compile_ns / passes, result.m_compile_ns / versions,
+                   result.m_execute_ns / passes, result.m_execute_ns / versions);
+        }
+
+        graph.release();
+    }
+
+    cbase::exit();
+    return 0;
+}
@@ -1,6 +1,20 @@
+#include "ccore/c_memory.h"
 #include "callocator/c_allocator_ocs.h"
 #include "cframegraph/c_framegraph.h"
 
+#if defined(_MSC_VER)
+#    include <intrin.h>
+#endif
+
+// Word operations of the bitset culling, 4 words at a time with AVX2, 2 words with SSE2, otherwise 1 word
+#if defined(__AVX2__)
+#    define FG_BITS_AVX2
+#    include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define FG_BITS_SSE2
+#    include <emmintrin.h>
+#endif
+
 namespace ncore
 {
     namespace nframegraph
@@ -23,6 +37,8 @@ namespace ncore
         {
             IMPORTED         = 0x0001,
             TRANSIENT        = 0x0002,
+            POOLED           = 0x0004, // the physical resource was taken from the pool, it does not need to be created
+            CLEAR            = 0x0008, // the pass that writes this version clears it (fg_clear)
             HAS_SIDE_EFFECTS = 0x8000,
         };
 
@@ -31,33 +47,384 @@ namespace ncore
             const char* m_name;
             FgExecuteFn m_execute_fn;
             u16         m_flags;
-            s16         m_final;      // intermediary or final
-            s32         m_ref_count;  // the number of resources that are written by this pass
-            FgRange     m_texture[3]; // the begin and end index into the 'create/read/write' texture array
-            FgRange     m_buffer[3];  // the begin and end index into the 'create/read/write' buffer array
+            s16         m_final;                // intermediary or final
+            s32         m_ref_count;            // the number of versions produced by this pass that are still referenced, 0 when culled
+            FgRange     m_texture[3];           // the begin and end index into the 'create/read/write' texture array
+            FgRange     m_buffer[3];            // the begin and end index into the 'create/read/write' buffer array
+            FgRange     m_texture_release;      // the begin and end index into the 'release' texture array (computed by fg_compile)
+            FgRange     m_buffer_release;       // the begin and end index into the 'release' buffer array (computed by fg_compile)
+            FgRange     m_successors;           // the begin and end index into the 'edge' array, passes that depend on this pass
+            FgRange     m_transitions;          // the begin and end index into the 'transition' array (computed by fg_compile)
+            FgRange     m_transitions_end;      // the split transitions that end before this pass, follows m_transitions
+            FgRange     m_transitions_begin;    // the begin and end index into the 'begin transition' array, split transitions that begin after this pass
+            FgRange     m_waits;                // the begin and end index into the 'sync' array, the sync points to wait for before this pass
+            s32         m_dependencies;         // the number of passes this pass depends on
+            FgRange     m_alias_successors;     // the begin and end index into the 'alias edge' array, passes that reuse the memory of its transients
+            s32         m_alias_dependencies;   // the number of passes whose transients share memory with the transients of this pass
+            s32         m_position;             // the position of this pass in the execution order, -1 when culled
+            s32         m_subpass;              // the index of this pass in its merged render pass, -1 when not merged
+            s32         m_subpass_count;        // the number of passes in its merged render pass
+            FgRange     m_subpass_dependencies; // first pass of a merged render pass, the transitions between its subpasses
+            FgQueue     m_queue;                // the queue this pass is submitted to
+            bool        m_signal;               // another queue waits for this pass
+            u32         m_value;                // the value of this pass on the timeline of its queue
         };
 
-        struct FgResourceInfo
+        static const FgIndex c_no_pass  = 0xFFFF;
+        static const FgIndex c_no_entry = 0xFFFF;
+
+        // The generation of the handles of a recorder, a graph never uses it (see fg_reset)
+        static const FgGeneration c_recorded_generation = 0xFFFF;
+
+        // The resource versions, textures and buffers in one table of columns. Texture 'i' is row 'i', buffer 'i' is row
+        // 'm_buffer_row + i'. The compile loops only touch the hot columns, the cold columns are used when declaring the
+        // graph and when creating and destroying the physical resources.
+        struct FgResourceTable
         {
-            const char* m_name;
-            FgPass      m_pass;
-            FgPass      m_last;
-            u32         m_flags;
-            s32         m_ref_count;
+            // Hot
+            s32*     m_ref_count;
+            FgIndex* m_pass;   // the pass that creates or writes this version, c_no_pass when imported
+            FgIndex* m_last;   // the last pass in execution order that accesses this version, c_no_pass when unused
+            FgIndex* m_root;   // the version that created the (physical) resource, a texture or buffer index
+            u16*     m_flags;  // EFlags
+            u16*     m_queues; // on the root, the mask of queues that access any version of the resource
+            u32*     m_access; // (index + 1) << 3 of the last pass that accessed this version, | (1 << FgType)
+
+            // Cold
+            const char** m_name;
+            void**       m_object; // GfxTexture* or GfxBuffer*
+            void**       m_descr;  // GfxTextureDescr* or GfxBufferDescr*
+
+            u32 m_buffer_row;
+        };
+
+        static void s_resource_table_setup(alloc_t* allocator, FgResourceTable& table, u32 capacity)
+        {
+            u32 const rows     = 2 * capacity;
+            table.m_ref_count  = g_allocate_array_and_clear<s32>(allocator, rows);
+            table.m_pass       = g_allocate_array_and_clear<FgIndex>(allocator, rows);
+            table.m_last       = g_allocate_array_and_clear<FgIndex>(allocator, rows);
+            table.m_root       = g_allocate_array_and_clear<FgIndex>(allocator, rows);
+            table.m_flags      = g_allocate_array_and_clear<u16>(allocator, rows);
+            table.m_queues     = g_allocate_array_and_clear<u16>(allocator, rows);
+            table.m_access     = g_allocate_array_and_clear<u32>(allocator, rows);
+            table.m_name       = g_allocate_array_and_clear<const char*>(allocator, rows);
+            table.m_object     = g_allocate_array_and_clear<void*>(allocator, rows);
+            table.m_descr      = g_allocate_array_and_clear<void*>(allocator, rows);
+            table.m_buffer_row = capacity;
+        }
+
+        static void s_resource_table_teardown(alloc_t* allocator, FgResourceTable& table)
+        {
+            g_deallocate_array(allocator, table.m_ref_count);
+            g_deallocate_array(allocator, table.m_pass);
+            g_deallocate_array(allocator, table.m_last);
+            g_deallocate_array(allocator, table.m_root);
+            g_deallocate_array(allocator, table.m_flags);
+            g_deallocate_array(allocator, table.m_queues);
+            g_deallocate_array(allocator, table.m_access);
+            g_deallocate_array(allocator, table.m_name);
+            g_deallocate_array(allocator, table.m_object);
+            g_deallocate_array(allocator, table.m_descr);
+        }
+
+        // A new version in 'row', the compile derived columns (ref-count, last and queues) are set by fg_compile
+        static void s_resource_set(FgResourceTable& table, u32 row, const char* name, FgIndex pass, u16 flags, FgIndex root, u32 access, void* object, void* descr)
+        {
+            table.m_name[row]   = name;
+            table.m_pass[row]   = pass;
+            table.m_flags[row]  = flags;
+            table.m_root[row]   = root;
+            table.m_access[row] = access;
+            table.m_object[row] = object;
+            table.m_descr[row]  = descr;
+        }
+
+        // Transient resources kept alive across frames, found back by the hash of their descriptor
+        struct FgPoolEntry
+        {
+            void* m_object; // GfxTexture* or GfxBuffer*
+            void* m_descr;  // GfxTextureDescr* or GfxBufferDescr*
+            u64   m_hash;
+            u32   m_frame; // the frame in which the object was released into the pool
+            s32   m_next;  // next entry in the same bucket, or in the free list
+        };
+
+        struct FgPool
+        {
+            FgPoolEntry* m_entries;
+            s32*         m_buckets;
+            u32          m_bucket_mask;
+            s32          m_free;
+            u32          m_capacity;
+            u32          m_max_unused_frames;
+        };
+
+        static void s_pool_setup(alloc_t* allocator, FgPool& pool, u32 capacity, u32 max_unused_frames)
+        {
+            u32 bucket_count = 16;
+            while (bucket_count < capacity)
+                bucket_count <<= 1;
+
+            pool.m_entries           = g_allocate_array_and_clear<FgPoolEntry>(allocator, capacity);
+            pool.m_buckets           = g_allocate_array_and_clear<s32>(allocator, bucket_count);
+            pool.m_bucket_mask       = bucket_count - 1;
+            pool.m_capacity          = capacity;
+            pool.m_max_unused_frames = max_unused_frames;
+            for (u32 i = 0; i < bucket_count; ++i)
+                pool.m_buckets[i] = -1;
+            for (u32 i = 0; i < capacity; ++i)
+                pool.m_entries[i].m_next = (i + 1) < capacity ? (s32)(i + 1) : -1;
+            pool.m_free = capacity > 0 ? 0 : -1;
+        }
+
+        static void s_pool_teardown(alloc_t* allocator, FgPool& pool)
+        {
+            g_deallocate_array(allocator, pool.m_entries);
+            g_deallocate_array(allocator, pool.m_buckets);
+            pool.m_entries  = nullptr;
+            pool.m_buckets  = nullptr;
+            pool.m_capacity = 0;
+        }
+
+        template <typename T, typename D>
+        static T* s_pool_acquire(FgPool& pool, callback_t<bool, D*, D*> const& equal, u64 hash, D* descr)
+        {
+            s32* link = &pool.m_buckets[hash & pool.m_bucket_mask];
+            while (*link >= 0)
+            {
+                FgPoolEntry& entry = pool.m_entries[*link];
+                if (entry.m_hash == hash && equal.Call((D*)entry.m_descr, descr))
+                {
+                    s32 const index = *link;
+                    *link           = entry.m_next;
+                    entry.m_next    = pool.m_free;
+                    pool.m_free     = index;
+                    return (T*)entry.m_object;
+                }
+                link = &entry.m_next;
+            }
+            return nullptr;
+        }
+
+        // Returns false when the pool is full, the caller should then destroy the object
+        static bool s_pool_release(FgPool& pool, u64 hash, void* object, void* descr, u32 frame)
+        {
+            if (pool.m_free < 0)
+                return false;
+            s32 const    index = pool.m_free;
+            FgPoolEntry& entry = pool.m_entries[index];
+            pool.m_free        = entry.m_next;
+            entry.m_object     = object;
+            entry.m_descr      = descr;
+            entry.m_hash       = hash;
+            entry.m_frame      = frame;
+            entry.m_next       = pool.m_buckets[hash & pool.m_bucket_mask];
+            pool.m_buckets[hash & pool.m_bucket_mask] = index;
+            return true;
+        }
+
+        // Destroys the entries that have been unused for too long (or all when 'all' is true)
+        template <typename T>
+        static void s_pool_evict(FgPool& pool, callback_t<void, GfxRenderContext*, T*> const& destroy, GfxRenderContext* ctxt, u32 frame, bool all)
+        {
+            if (pool.m_buckets == nullptr)
+                return;
+            for (u32 b = 0; b <= pool.m_bucket_mask; ++b)
+            {
+                s32* link = &pool.m_buckets[b];
+                while (*link >= 0)
+                {
+                    FgPoolEntry& entry = pool.m_entries[*link];
+                    if (all || (frame - entry.m_frame) >= pool.m_max_unused_frames)
+                    {
+                        destroy.Call(ctxt, (T*)entry.m_object);
+                        s32 const index = *link;
+                        *link           = entry.m_next;
+                        entry.m_next    = pool.m_free;
+                        pool.m_free     = index;
+                    }
+                    else
+                    {
+                        link = &entry.m_next;
+                    }
+                }
+            }
+        }
+
+        // Subresource ranges, a rectangle in (mip, slice) space. s_subresource_all covers any mip and slice count.
+        static inline u32 s_min(u32 a, u32 b) { return a < b ? a : b; }
+        static inline u32 s_max(u32 a, u32 b) { return a > b ? a : b; }
+        static inline u32 s_mip_end(FgSubresource const& r) { return (u32)r.m_mip + r.m_mip_count; }
+        static inline u32 s_slice_end(FgSubresource const& r) { return (u32)r.m_slice + r.m_slice_count; }
+        static inline u64 s_subresource_key(FgSubresource const& r) { return ((u64)r.m_mip << 48) | ((u64)r.m_mip_count << 32) | ((u64)r.m_slice << 16) | r.m_slice_count; }
+        static inline bool s_subresource_overlaps(FgSubresource const& a, FgSubresource const& b)
+        {
+            return a.m_mip < s_mip_end(b) && b.m_mip < s_mip_end(a) && a.m_slice < s_slice_end(b) && b.m_slice < s_slice_end(a);
+        }
+        static inline bool s_subresource_contains(FgSubresource const& a, FgSubresource const& b)
+        {
+            return a.m_mip <= b.m_mip && s_mip_end(b) <= s_mip_end(a) && a.m_slice <= b.m_slice && s_slice_end(b) <= s_slice_end(a);
+        }
+        static inline FgSubresource s_subresource_make(u32 mip, u32 mip_end, u32 slice, u32 slice_end) { return {(u16)mip, (u16)(mip_end - mip), (u16)slice, (u16)(slice_end - slice)}; }
+        static inline FgSubresource s_subresource_intersect(FgSubresource const& a, FgSubresource const& b)
+        {
+            return s_subresource_make(s_max(a.m_mip, b.m_mip), s_min(s_mip_end(a), s_mip_end(b)), s_max(a.m_slice, b.m_slice), s_min(s_slice_end(a), s_slice_end(b)));
+        }
+
+        // The parts of 'a' outside of 'b' (which overlaps 'a'), at most four ranges: the mips of 'a' below and above 'b'
+        // with all the slices of 'a', and within the mips of 'b' the slices of 'a' below and above 'b'.
+        static s32 s_subresource_subtract(FgSubresource const& a, FgSubresource const& b, FgSubresource* out)
+        {
+            s32       count   = 0;
+            u32 const mip     = s_max(a.m_mip, b.m_mip);
+            u32 const mip_end = s_min(s_mip_end(a), s_mip_end(b));
+            if (a.m_mip < b.m_mip)
+                out[count++] = s_subresource_make(a.m_mip, b.m_mip, a.m_slice, s_slice_end(a));
+            if (s_mip_end(b) < s_mip_end(a))
+                out[count++] = s_subresource_make(s_mip_end(b), s_mip_end(a), a.m_slice, s_slice_end(a));
+            if (a.m_slice < b.m_slice)
+                out[count++] = s_subresource_make(mip, mip_end, a.m_slice, b.m_slice);
+            if (s_slice_end(b) < s_slice_end(a))
+                out[count++] = s_subresource_make(mip, mip_end, s_slice_end(b), s_slice_end(a));
+            return count;
+        }
+
+        static const s32 c_max_heaps         = 64;
+        static const s32 c_max_history       = 16;
+        static const u32 c_transition_buffer = 0x10000;
+
+        // A ping-pong pair of textures that lives across frames, imported into every frame on first use
+        struct FgHistoryInfo
+        {
+            const char*      m_name;
+            GfxTexture*      m_texture[2];
+            GfxTextureDescr* m_descr;
+            u32              m_frames;        // the number of frames that used the current texture
+            u8               m_current;       // the texture that is written in this frame
+            FgIndex          m_index[2];      // the imported version of each texture in the frame of 'm_generation'
+            u32              m_generation[2]; // the resource generation of the frame the texture was imported in
+        };
+
+        // Structural hash of the declared graph, an FNV-1a style mix of 64-bit words
+        static const u64  c_hash_seed = 0xCBF29CE484222325ull;
+        static inline u64 s_hash_mix(u64 hash, u64 value)
+        {
+            hash = (hash ^ value) * 0x100000001B3ull;
+            return hash ^ (hash >> 29);
+        }
+
+        // Reallocates 'array' with 'capacity' elements and keeps the first 'count' of them
+        template <typename T>
+        static T* s_grow_array(alloc_t* allocator, T* array, s32 count, s32 capacity)
+        {
+            T* grown = g_allocate_array<T>(allocator, capacity);
+            if (count > 0)
+                nmem::memcpy(grown, array, count * sizeof(T));
+            g_deallocate_array(allocator, array);
+            return grown;
+        }
+
+        // Forwards to another allocator and counts the allocations (see fg_get_allocation_count)
+        class FgCountingAlloc : public alloc_t
+        {
+        public:
+            DCORE_CLASS_PLACEMENT_NEW_DELETE
+
+            FgCountingAlloc(alloc_t* allocator, u32* count)
+                : m_allocator(allocator)
+                , m_count(count)
+            {
+            }
+
+            alloc_t* m_allocator;
+            u32*     m_count;
+
+        protected:
+            virtual void* v_allocate(u32 size, u32 alignment)
+            {
+                *m_count += 1;
+                return m_allocator->allocate(size, alignment);
+            }
+            virtual void v_deallocate(void* ptr) { m_allocator->deallocate(ptr); }
+        };
+
+        // Bump allocator on a region owned by the graph and rewound by every fg_compile, memory that is released is only
+        // reused by the next compile. An allocation that does not fit comes from the fallback (see fg_set_scratch).
+        class FgScratchAlloc : public alloc_t
+        {
+        public:
+            DCORE_CLASS_PLACEMENT_NEW_DELETE
+
+            FgScratchAlloc()
+                : m_begin(nullptr)
+                , m_capacity(0)
+                , m_cursor(0)
+                , m_peak(0)
+                , m_fallback(nullptr)
+            {
+            }
+
+            u8*      m_begin; // aligned to c_scratch_alignment
+            u32      m_capacity;
+            u32      m_cursor;
+            u32      m_peak; // the most memory a compile used, including what did not fit
+            alloc_t* m_fallback;
+
+        protected:
+            virtual void* v_allocate(u32 size, u32 alignment)
+            {
+                u32 const offset = (m_cursor + (alignment - 1)) & ~(alignment - 1);
+                m_cursor         = offset + size;
+                m_peak           = m_cursor > m_peak ? m_cursor : m_peak;
+                if (m_cursor > m_capacity)
+                    return m_fallback->allocate(size, alignment);
+                return m_begin + offset;
+            }
+            virtual void v_deallocate(void* ptr)
+            {
+                if ((u8*)ptr < m_begin || (u8*)ptr >= m_begin + m_capacity)
+                    m_fallback->deallocate(ptr);
+            }
         };
 
-        struct FgTextureInfo
+        static const u32 c_scratch_alignment = 64;
+
+        // Frame-linear arena for the data of fg_add_pass, rewound every frame
+        struct FgPassDataArena
         {
-            FgResourceInfo   m_resource;
-            GfxTexture*      m_texture;
-            GfxTextureDescr* m_textureDescr;
+            u8* m_data;
+            u32 m_capacity;
+            u32 m_cursor;
         };
 
-        struct FgBufferInfo
+        static void s_arena_setup(alloc_t* allocator, FgPassDataArena& arena, u32 capacity)
         {
-            FgResourceInfo  m_resource;
-            GfxBuffer*      m_buffer;
-            GfxBufferDescr* m_bufferDescr;
+            arena.m_data     = capacity > 0 ? g_allocate_array<u8>(allocator, capacity) : nullptr;
+            arena.m_capacity = capacity;
+            arena.m_cursor   = 0;
+        }
+
+        static void s_arena_teardown(alloc_t* allocator, FgPassDataArena& arena) { g_deallocate_array(allocator, arena.m_data); }
+
+        static void* s_arena_allocate(FgPassDataArena& arena, u32 size, u32 alignment)
+        {
+            u32 const offset = (arena.m_cursor + (alignment - 1)) & ~(alignment - 1);
+            ASSERT(offset + size <= arena.m_capacity);
+            arena.m_cursor = offset + size;
+
+            void* data = arena.m_data + offset;
+            nmem::memset(data, 0, size);
+            return data;
+        }
+
+        // Ring of trace events, see fg_set_trace
+        struct FgTrace
+        {
+            FgTraceEvent*   m_events;
+            u32             m_capacity;
+            s32             m_cursor; // the number of events written, the next one goes to m_cursor % m_capacity
+            callback_t<u64> m_clock;
         };
 
         struct Fg
@@ -68,8 +435,23 @@ namespace ncore
             bool is_valid(FgBuffer resource) const;
             bool pass_contains(FgPass pass, FgType type, FgTexture resource) const;
             bool pass_contains(FgPass pass, FgType type, FgBuffer resource) const;
+            void pass_mark(FgPass pass, FgType type, FgTexture resource);
+            void pass_mark(FgPass pass, FgType type, FgBuffer resource);
+            u32  access_stamp(FgPass pass) const { return (u32)(pass - m_passinfo_array + 1) << 3; }
 
-            alloc_t*       m_allocator;
+            // Rows of the resource table, and the 16-bit pass indices it stores
+            u32     texture_row(FgIndex index) const { return index; }
+            u32     buffer_row(FgIndex index) const { return m_resources.m_buffer_row + index; }
+            FgIndex pass_index(FgPass pass) const { return pass != nullptr ? (FgIndex)(pass - m_passinfo_array) : c_no_pass; }
+            FgPass  pass_at(FgIndex index) const { return index != c_no_pass ? &m_passinfo_array[index] : nullptr; }
+
+            // Every version of a resource uses the GfxTexture/GfxBuffer of the version that created it
+            GfxTexture*      physical_texture(FgIndex index) const { return (GfxTexture*)m_resources.m_object[texture_row(m_resources.m_root[texture_row(index)])]; }
+            GfxBuffer*       physical_buffer(FgIndex index) const { return (GfxBuffer*)m_resources.m_object[buffer_row(m_resources.m_root[buffer_row(index)])]; }
+            GfxTextureDescr* texture_descr(FgIndex index) const { return (GfxTextureDescr*)m_resources.m_descr[texture_row(index)]; }
+            GfxBufferDescr*  buffer_descr(FgIndex index) const { return (GfxBufferDescr*)m_resources.m_descr[buffer_row(index)]; }
+
+            alloc_t*       m_allocator; // the allocator of fg_setup, through m_audit
             u32            m_resource_array_capacity; // maximum number of resources
             u32            m_resource_generation;     // ID to make resources unique and recognize invalid resources
             u32            m_pass_array_capacity;
@@ -80,28 +462,115 @@ namespace ncore
             FgIndex        m_textureinfo_cursor[3]; // current number of create texture info resources
             FgIndex        m_bufferinfo_cursor_main;
             FgIndex        m_bufferinfo_cursor[3]; // current number of create buffer info resources
-            FgTextureInfo* m_textureinfo_array;
             FgFlags*       m_textureinfo_flags;
             FgIndex*       m_textureinfo_crw_array[3];
-            FgBufferInfo*  m_bufferinfo_array;
+            FgFlags*       m_textureinfo_crw_flags[3]; // per create/read/write entry, the flags of that access
+            FgSubresource* m_textureinfo_crw_range[3]; // per create/read/write entry, the subresources it accesses
+            FgIndex*       m_textureinfo_read_last;    // per texture version, the last read entry of the pass that last read it
+            FgIndex*       m_textureinfo_read_prev;    // per read entry, the previous read entry of the version in the pass
+            FgIndex*       m_textureinfo_release_array; // per pass, the physical textures to destroy after the pass
             FgFlags*       m_bufferinfo_flags;
             FgIndex*       m_bufferinfo_crw_array[3];
+            FgFlags*       m_bufferinfo_crw_flags[3]; // per create/read/write entry, the flags of that access
+            FgIndex*       m_bufferinfo_release_array; // per pass, the physical buffers to destroy after the pass
+            FgPlacement*   m_textureinfo_placement;    // per physical texture, the memory placement (aliasing)
+            FgPlacement*   m_bufferinfo_placement;     // per physical buffer, the memory placement (aliasing)
+
+            FgResourceTable  m_resources;       // per texture and buffer version, see FgResourceTable
+            FgAttachmentOps* m_textureinfo_ops; // per texture version, the load/store ops of the pass that writes it
+
+            bool m_aliasing_texture;
+            bool m_aliasing_buffer;
+            u64  m_heap_capacity; // 0 = unlimited
+            s32  m_heap_count;
+            u64  m_heap_size[c_max_heaps];
+
+            s32           m_history_count;
+            FgHistoryInfo m_history[c_max_history];
+
+            FgPassDataArena m_pass_data; // the data of fg_add_pass
+
+            bool          m_batched_transitions;
+            bool          m_split_transitions;
+            u32           m_transition_capacity;
+            s32           m_transition_count;
+            s32           m_transition_begin_count;
+            FgTransition* m_transition_array;       // per pass, the state transitions before the pass (see FgPassInfo::m_transitions)
+            u32*          m_transition_resource;    // per transition, the physical resource (buffers have c_transition_buffer set)
+            FgTransition* m_transition_begin_array; // per pass, the split transitions that begin after the pass
+            u32*          m_transition_begin_index; // per begin transition, the index of the transition in m_transition_array
 
-            callback_t<void, GfxRenderContext*, GfxTexture*, GfxTextureDescr*> m_create_texture;
-            callback_t<void, GfxRenderContext*, GfxTexture*, FgFlags>          m_preread_texture;
-            callback_t<void, GfxRenderContext*, GfxTexture*, FgFlags>          m_prewrite_texture;
-            callback_t<void, GfxRenderContext*, GfxTexture*>                   m_destroy_texture;
-            callback_t<void, GfxRenderContext*, GfxBuffer*, GfxBufferDescr*>   m_create_buffer;
-            callback_t<void, GfxRenderContext*, GfxBuffer*, FgFlags>           m_preread_buffer;
-            callback_t<void, GfxRenderContext*, GfxBuffer*, FgFlags>           m_prewrite_buffer;
-            callback_t<void, GfxRenderContext*, GfxBuffer*>                    m_destroy_buffer;
+            FgSyncPoint* m_sync_array; // per pass, the sync points to wait for (see FgPassInfo::m_waits)
+
+            bool     m_memory_schedule;
+            bool     m_merge_render_passes;
+            bool     m_bitset_culling;
+            FgIndex* m_order;       // the live passes in execution order
+            FgPass*  m_order_pass;  // the live passes in execution order, the subpasses of a merged render pass
+            s32      m_order_count;
+            u64      m_peak_declared;  // peak transient memory when executing in declaration order
+            u64      m_peak_scheduled; // peak transient memory when executing in 'm_order'
+            s32      m_longest_chain;  // the number of passes on the longest chain of dependencies
+            u64      m_compile_ticks;  // the duration of the last fg_compile
+
+            s32 m_executed_count;  // the passes executed by the last fg_execute
+            s32 m_created_count;   // the transients created by the last fg_execute
+            s32 m_destroyed_count; // the transients destroyed by the last fg_execute
+
+            u32      m_edge_capacity;
+            FgIndex* m_edge_array;       // per pass, the passes that depend on it (see FgPassInfo::m_successors)
+            u32      m_alias_edge_capacity;
+            FgIndex* m_alias_edge_array; // per pass, the passes that reuse the memory of its transients (see FgPassInfo::m_alias_successors)
+            s32*     m_pass_pending;     // parallel execution, per pass the number of dependencies that did not finish yet
+            s32*     m_ready_array;      // parallel execution, the queue of passes that are ready to be executed
+
+            u64  m_structure_hash;       // mixed while the graph is declared
+            u64  m_compiled_hash;        // structure hash of the last compiled graph
+            u64  m_compiled_memory_hash; // memory requirements of the transients at the last aliasing plan
+            bool m_compiled;
+
+            FgCountingAlloc m_audit;            // counts the allocations made with the allocator of fg_setup
+            FgScratchAlloc  m_scratch;          // compile memory, see fg_set_scratch
+            u32             m_allocation_count; // since fg_reset, through m_allocator or the allocator of fg_compile
+            FgTrace         m_trace;
+
+            u32    m_frame_index;
+            FgPool m_texture_pool;
+            FgPool m_buffer_pool;
+            bool   m_pool_taken; // fg_compile took transients from the pools that fg_execute has not released yet
+
+            callback_t<void, GfxRenderContext*, GfxTexture*, GfxTextureDescr*>    m_create_texture;
+            callback_t<void, GfxRenderContext*, GfxTexture*, FgFlags>             m_preread_texture;
+            callback_t<void, GfxRenderContext*, GfxTexture*, FgFlags>             m_prewrite_texture;
+            callback_t<void, GfxRenderContext*, GfxTexture*, FgFlags, FgAttachmentOps> m_prewrite_attachment;
+            callback_t<void, GfxRenderContext*, GfxTexture*>                      m_destroy_texture;
+            callback_t<void, GfxRenderContext*, GfxBuffer*, GfxBufferDescr*>      m_create_buffer;
+            callback_t<void, GfxRenderContext*, GfxBuffer*, FgFlags>              m_preread_buffer;
+            callback_t<void, GfxRenderContext*, GfxBuffer*, FgFlags>              m_prewrite_buffer;
+            callback_t<void, GfxRenderContext*, GfxBuffer*>                       m_destroy_buffer;
+            callback_t<void, GfxRenderContext*, FgTransition const*, s32>         m_transitions;
+            callback_t<void, GfxRenderContext*, FgTransition const*, s32>         m_begin_transitions;
+            callback_t<void, GfxRenderContext*, FgTransition const*, s32>         m_end_transitions;
+            callback_t<void, GfxRenderContext*, FgQueue, FgSyncPoint const*, s32>      m_queue_wait;
+            callback_t<void, GfxRenderContext*, FgQueue, u32>                     m_queue_signal;
+            callback_t<FgAttachment, FgFlags>                                     m_classify_attachment;
+            callback_t<void, GfxRenderContext*, FgRenderPass const*>              m_begin_render_pass;
+            callback_t<void, GfxRenderContext*, FgRenderPass const*>              m_end_render_pass;
+            callback_t<void, GfxTextureDescr*, FgMemoryRequirements*>             m_memory_texture;
+            callback_t<void, GfxBufferDescr*, FgMemoryRequirements*>              m_memory_buffer;
+            callback_t<u64, GfxTextureDescr*>                                     m_hash_texture;
+            callback_t<bool, GfxTextureDescr*, GfxTextureDescr*>                  m_equal_texture;
+            callback_t<u64, GfxBufferDescr*>                                      m_hash_buffer;
+            callback_t<bool, GfxBufferDescr*, GfxBufferDescr*>                    m_equal_buffer;
         };
 
-        Fg* fg_setup(alloc_t* allocator, u32 resource_capacity, u32 pass_capacity)
+        Fg* fg_setup(alloc_t* allocator, u32 resource_capacity, u32 pass_capacity, u32 pass_data_capacity)
         {
             Fg* fg = g_allocate_and_clear<Fg>(allocator);
 
-            fg->m_allocator = allocator;
+            new (&fg->m_audit) FgCountingAlloc(allocator, &fg->m_allocation_count);
+            new (&fg->m_scratch) FgScratchAlloc();
+            fg->m_allocator = &fg->m_audit;
 
             fg->m_resource_array_capacity = resource_capacity;
             fg->m_resource_generation     = 0;
@@ -110,16 +579,56 @@ namespace ncore
             fg->m_pass_array_capacity = pass_capacity;
             fg->m_passinfo_array      = g_allocate_array_and_clear<FgPassInfo>(allocator, pass_capacity);
 
-            fg->m_textureinfo_array = g_allocate_array_and_clear<FgTextureInfo>(allocator, resource_capacity);
+            s_arena_setup(allocator, fg->m_pass_data, pass_data_capacity);
+
+            // Pass indices are 16-bit, c_no_pass is not a valid index
+            ASSERT(pass_capacity < c_no_pass);
+            s_resource_table_setup(allocator, fg->m_resources, resource_capacity);
             fg->m_textureinfo_flags = g_allocate_array_and_clear<FgFlags>(allocator, resource_capacity);
-            fg->m_bufferinfo_array  = g_allocate_array_and_clear<FgBufferInfo>(allocator, resource_capacity);
             fg->m_bufferinfo_flags  = g_allocate_array_and_clear<FgFlags>(allocator, resource_capacity);
 
             for (s32 i = FgCreate; i <= FgWrite; ++i)
             {
                 fg->m_textureinfo_crw_array[i] = g_allocate_array_and_clear<FgIndex>(allocator, resource_capacity);
                 fg->m_bufferinfo_crw_array[i]  = g_allocate_array_and_clear<FgIndex>(allocator, resource_capacity);
+                fg->m_textureinfo_crw_flags[i] = g_allocate_array_and_clear<FgFlags>(allocator, resource_capacity);
+                fg->m_textureinfo_crw_range[i] = g_allocate_array_and_clear<FgSubresource>(allocator, resource_capacity);
+                fg->m_bufferinfo_crw_flags[i]  = g_allocate_array_and_clear<FgFlags>(allocator, resource_capacity);
             }
+            fg->m_textureinfo_release_array = g_allocate_array_and_clear<FgIndex>(allocator, resource_capacity);
+            fg->m_bufferinfo_release_array  = g_allocate_array_and_clear<FgIndex>(allocator, resource_capacity);
+            fg->m_textureinfo_placement     = g_allocate_array_and_clear<FgPlacement>(allocator, resource_capacity);
+            fg->m_bufferinfo_placement      = g_allocate_array_and_clear<FgPlacement>(allocator, resource_capacity);
+            fg->m_textureinfo_ops           = g_allocate_array_and_clear<FgAttachmentOps>(allocator, resource_capacity);
+            fg->m_textureinfo_read_last     = g_allocate_array_and_clear<FgIndex>(allocator, resource_capacity);
+            fg->m_textureinfo_read_prev     = g_allocate_array_and_clear<FgIndex>(allocator, resource_capacity);
+
+            // One transition per read or write entry, an entry with a subresource range that overlaps several ranges with
+            // a different state has one per range, fg_compile grows them when they do not fit
+            fg->m_transition_capacity    = 8 * resource_capacity;
+            fg->m_transition_array       = g_allocate_array_and_clear<FgTransition>(allocator, fg->m_transition_capacity);
+            fg->m_transition_resource    = g_allocate_array_and_clear<u32>(allocator, fg->m_transition_capacity);
+            fg->m_transition_begin_array = g_allocate_array_and_clear<FgTransition>(allocator, fg->m_transition_capacity);
+            fg->m_transition_begin_index = g_allocate_array_and_clear<u32>(allocator, fg->m_transition_capacity);
+
+            fg->m_order      = g_allocate_array_and_clear<FgIndex>(allocator, pass_capacity);
+            fg->m_order_pass = g_allocate_array_and_clear<FgPass>(allocator, pass_capacity);
+
+            // A pass waits at most once for each of the other queues
+            fg->m_sync_array = g_allocate_array_and_clear<FgSyncPoint>(allocator, (FgQueueCount - 1) * pass_capacity);
+
+            // A dependency is only added for a read (creator, RAW, WAR) or a write (creator, WAW), accesses of partially
+            // overlapping subresources can add more and then fg_compile grows the edges
+            fg->m_edge_capacity = 10 * resource_capacity;
+            fg->m_edge_array    = g_allocate_array_and_clear<FgIndex>(allocator, fg->m_edge_capacity);
+            fg->m_pass_pending  = g_allocate_array_and_clear<s32>(allocator, pass_capacity);
+
+            // Aliasing adds edges between the passes of transients that share memory, fg_compile grows them when needed
+            fg->m_alias_edge_capacity = resource_capacity;
+            fg->m_alias_edge_array    = g_allocate_array_and_clear<FgIndex>(allocator, fg->m_alias_edge_capacity);
+            fg->m_ready_array   = g_allocate_array_and_clear<s32>(allocator, pass_capacity);
+
+            fg->m_structure_hash = c_hash_seed;
 
             return fg;
         }
@@ -127,24 +636,119 @@ namespace ncore
         void fg_teardown(Fg*& fg)
         {
             g_deallocate_array(fg->m_allocator, fg->m_passinfo_array);
-            g_deallocate_array(fg->m_allocator, fg->m_textureinfo_array);
+            s_arena_teardown(fg->m_allocator, fg->m_pass_data);
+            s_resource_table_teardown(fg->m_allocator, fg->m_resources);
             g_deallocate_array(fg->m_allocator, fg->m_textureinfo_flags);
-            g_deallocate_array(fg->m_allocator, fg->m_bufferinfo_array);
             g_deallocate_array(fg->m_allocator, fg->m_bufferinfo_flags);
 
             for (s32 i = FgCreate; i <= FgWrite; ++i)
             {
                 g_deallocate_array(fg->m_allocator, fg->m_textureinfo_crw_array[i]);
                 g_deallocate_array(fg->m_allocator, fg->m_bufferinfo_crw_array[i]);
+                g_deallocate_array(fg->m_allocator, fg->m_textureinfo_crw_flags[i]);
+                g_deallocate_array(fg->m_allocator, fg->m_textureinfo_crw_range[i]);
+                g_deallocate_array(fg->m_allocator, fg->m_bufferinfo_crw_flags[i]);
             }
+            g_deallocate_array(fg->m_allocator, fg->m_textureinfo_release_array);
+            g_deallocate_array(fg->m_allocator, fg->m_bufferinfo_release_array);
+            g_deallocate_array(fg->m_allocator, fg->m_textureinfo_placement);
+            g_deallocate_array(fg->m_allocator, fg->m_textureinfo_ops);
+            g_deallocate_array(fg->m_allocator, fg->m_textureinfo_read_last);
+            g_deallocate_array(fg->m_allocator, fg->m_textureinfo_read_prev);
+            g_deallocate_array(fg->m_allocator, fg->m_bufferinfo_placement);
+            g_deallocate_array(fg->m_allocator, fg->m_transition_array);
+            g_deallocate_array(fg->m_allocator, fg->m_transition_resource);
+            g_deallocate_array(fg->m_allocator, fg->m_transition_begin_array);
+            g_deallocate_array(fg->m_allocator, fg->m_transition_begin_index);
+            g_deallocate_array(fg->m_allocator, fg->m_order);
+            g_deallocate_array(fg->m_allocator, fg->m_order_pass);
+            g_deallocate_array(fg->m_allocator, fg->m_sync_array);
+            g_deallocate_array(fg->m_allocator, fg->m_edge_array);
+            g_deallocate_array(fg->m_allocator, fg->m_alias_edge_array);
+            g_deallocate_array(fg->m_allocator, fg->m_pass_pending);
+            g_deallocate_array(fg->m_allocator, fg->m_ready_array);
+            s_pool_teardown(fg->m_allocator, fg->m_texture_pool);
+            s_pool_teardown(fg->m_allocator, fg->m_buffer_pool);
+            if (fg->m_scratch.m_begin != nullptr)
+                fg->m_allocator->deallocate(fg->m_scratch.m_begin);
+            g_deallocate_array(fg->m_allocator, fg->m_trace.m_events);
 
-            g_deallocate(fg->m_allocator, fg);
+            alloc_t* allocator = fg->m_audit.m_allocator;
+            g_deallocate(allocator, fg);
             fg = nullptr;
         }
 
+        // Hands the transients that fg_compile took from the pools back when the frame was not executed, their entries
+        // were freed when they were taken so they always fit
+        static void s_pool_return(Fg* fg)
+        {
+            for (u32 i = 0; i < fg->m_pass_array_size; ++i)
+            {
+                FgPassInfo const* pass = &fg->m_passinfo_array[i];
+                for (s32 j = pass->m_texture_release.begin; j < pass->m_texture_release.end; ++j)
+                {
+                    FgIndex const index = fg->m_textureinfo_release_array[j];
+                    if ((fg->m_resources.m_flags[fg->texture_row(index)] & POOLED) == POOLED)
+                    {
+                        bool const returned = s_pool_release(fg->m_texture_pool, fg->m_hash_texture.Call(fg->texture_descr(index)), fg->physical_texture(index), fg->texture_descr(index), fg->m_frame_index);
+                        ASSERT(returned);
+                    }
+                }
+                for (s32 j = pass->m_buffer_release.begin; j < pass->m_buffer_release.end; ++j)
+                {
+                    FgIndex const index = fg->m_bufferinfo_release_array[j];
+                    if ((fg->m_resources.m_flags[fg->buffer_row(index)] & POOLED) == POOLED)
+                    {
+                        bool const returned = s_pool_release(fg->m_buffer_pool, fg->m_hash_buffer.Call(fg->buffer_descr(index)), fg->physical_buffer(index), fg->buffer_descr(index), fg->m_frame_index);
+                        ASSERT(returned);
+                    }
+                }
+            }
+            fg->m_pool_taken = false;
+        }
+
+        void fg_reset(Fg* fg)
+        {
+            ASSERT(fg->m_current_passinfo == nullptr);
+
+            // A compiled frame that was not executed still holds the transients it took from the pools
+            if (fg->m_pool_taken)
+                s_pool_return(fg);
+
+            // What the ending frame wrote into a history texture is what the next frame reads
+            for (s32 i = 0; i < fg->m_history_count; ++i)
+            {
+                FgHistoryInfo* history = &fg->m_history[i];
+                if (history->m_generation[history->m_current] == fg->m_resource_generation)
+                {
+                    history->m_current ^= 1;
+                    history->m_frames += 1;
+                }
+            }
+
+            // FgTexture and FgBuffer carry a 16-bit generation, c_recorded_generation marks the handles of a recorder
+            fg->m_resource_generation = (fg->m_resource_generation + 1) % c_recorded_generation;
+
+            fg->m_pass_array_size         = 0;
+            fg->m_pass_data.m_cursor      = 0;
+            fg->m_textureinfo_cursor_main = 0;
+            fg->m_bufferinfo_cursor_main  = 0;
+            for (s32 i = FgCreate; i <= FgWrite; ++i)
+            {
+                fg->m_textureinfo_cursor[i] = 0;
+                fg->m_bufferinfo_cursor[i]  = 0;
+            }
+
+            // The compile results are kept, fg_compile reuses them when the next frame has the same structure
+            fg->m_structure_hash = c_hash_seed;
+
+            fg->m_allocation_count = 0;
+        }
+
         void fg_set_create_texture(Fg* fg, callback_t<void, GfxRenderContext*, GfxTexture*, GfxTextureDescr*> fn) { fg->m_create_texture = fn; }
         void fg_set_preread_texture(Fg* fg, callback_t<void, GfxRenderContext*, GfxTexture*, FgFlags> fn) { fg->m_preread_texture = fn; }
         void fg_set_prewrite_texture(Fg* fg, callback_t<void, GfxRenderContext*, GfxTexture*, FgFlags> fn) { fg->m_prewrite_texture = fn; }
+        void fg_set_prewrite_texture(Fg* fg, callback_t<void, GfxRenderContext*, GfxTexture*, FgFlags, FgAttachmentOps> fn) { fg->m_prewrite_attachment = fn; }
         void fg_set_destroy_texture(Fg* fg, callback_t<void, GfxRenderContext*, GfxTexture*> fn) { fg->m_destroy_texture = fn; }
 
         void fg_set_create_buffer(Fg* fg, callback_t<void, GfxRenderContext*, GfxBuffer*, GfxBufferDescr*> fn) { fg->m_create_buffer = fn; }
@@ -152,16 +756,104 @@ namespace ncore
         void fg_set_prewrite_buffer(Fg* fg, callback_t<void, GfxRenderContext*, GfxBuffer*, FgFlags> fn) { fg->m_prewrite_buffer = fn; }
         void fg_set_destroy_buffer(Fg* fg, callback_t<void, GfxRenderContext*, GfxBuffer*> fn) { fg->m_destroy_buffer = fn; }
 
-        static FgPass s_fg_open_pass(Fg* fg, const char* name, FgExecuteFn execute, s16 final)
+        void fg_set_transitions(Fg* fg, callback_t<void, GfxRenderContext*, FgTransition const*, s32> fn)
+        {
+            fg->m_transitions         = fn;
+            fg->m_batched_transitions = true;
+        }
+
+        void fg_set_split_transitions(Fg* fg, callback_t<void, GfxRenderContext*, FgTransition const*, s32> begin, callback_t<void, GfxRenderContext*, FgTransition const*, s32> end)
+        {
+            ASSERT(fg->m_batched_transitions);
+            fg->m_begin_transitions = begin;
+            fg->m_end_transitions   = end;
+            fg->m_split_transitions = true;
+        }
+
+        void fg_set_queue_sync(Fg* fg, callback_t<void, GfxRenderContext*, FgQueue, FgSyncPoint const*, s32> wait, callback_t<void, GfxRenderContext*, FgQueue, u32> signal)
+        {
+            fg->m_queue_wait   = wait;
+            fg->m_queue_signal = signal;
+        }
+
+        void fg_set_memory_texture(Fg* fg, callback_t<void, GfxTextureDescr*, FgMemoryRequirements*> fn)
+        {
+            fg->m_memory_texture   = fn;
+            fg->m_aliasing_texture = true;
+        }
+        void fg_set_memory_buffer(Fg* fg, callback_t<void, GfxBufferDescr*, FgMemoryRequirements*> fn)
+        {
+            fg->m_memory_buffer   = fn;
+            fg->m_aliasing_buffer = true;
+        }
+        void fg_set_heap_size(Fg* fg, u64 heap_size) { fg->m_heap_capacity = heap_size; }
+        void fg_set_memory_schedule(Fg* fg, bool enable)
+        {
+            fg->m_memory_schedule = enable;
+            fg->m_compiled        = false;
+        }
+
+        void fg_set_bitset_culling(Fg* fg, bool enable)
+        {
+            fg->m_bitset_culling = enable;
+            fg->m_compiled       = false;
+        }
+
+        void fg_set_render_pass_merging(Fg* fg, callback_t<FgAttachment, FgFlags> classify, callback_t<void, GfxRenderContext*, FgRenderPass const*> begin, callback_t<void, GfxRenderContext*, FgRenderPass const*> end)
+        {
+            fg->m_classify_attachment = classify;
+            fg->m_begin_render_pass   = begin;
+            fg->m_end_render_pass     = end;
+            fg->m_merge_render_passes = true;
+            fg->m_compiled            = false;
+        }
+
+        void fg_set_texture_pool(Fg* fg, u32 capacity, u32 max_unused_frames, callback_t<u64, GfxTextureDescr*> hash, callback_t<bool, GfxTextureDescr*, GfxTextureDescr*> equal)
+        {
+            ASSERT(fg->m_texture_pool.m_capacity == 0);
+            s_pool_setup(fg->m_allocator, fg->m_texture_pool, capacity, max_unused_frames);
+            fg->m_hash_texture  = hash;
+            fg->m_equal_texture = equal;
+        }
+
+        void fg_set_buffer_pool(Fg* fg, u32 capacity, u32 max_unused_frames, callback_t<u64, GfxBufferDescr*> hash, callback_t<bool, GfxBufferDescr*, GfxBufferDescr*> equal)
+        {
+            ASSERT(fg->m_buffer_pool.m_capacity == 0);
+            s_pool_setup(fg->m_allocator, fg->m_buffer_pool, capacity, max_unused_frames);
+            fg->m_hash_buffer  = hash;
+            fg->m_equal_buffer = equal;
+        }
+
+        void fg_set_scratch(Fg* fg, u32 capacity)
         {
+            if (fg->m_scratch.m_begin != nullptr)
+                fg->m_allocator->deallocate(fg->m_scratch.m_begin);
+            fg->m_scratch.m_begin    = capacity > 0 ? (u8*)fg->m_allocator->allocate(capacity, c_scratch_alignment) : nullptr;
+            fg->m_scratch.m_capacity = capacity;
+            fg->m_scratch.m_cursor   = 0;
+            fg->m_scratch.m_peak     = 0;
+        }
+
+        u32 fg_get_allocation_count(Fg* fg) { return fg->m_allocation_count; }
+        u32 fg_get_scratch_peak(Fg* fg) { return fg->m_scratch.m_peak; }
+
+        void fg_flush_pools(Fg* fg, GfxRenderContext* ctxt)
+        {
+            s_pool_evict(fg->m_texture_pool, fg->m_destroy_texture, ctxt, fg->m_frame_index, true);
+            s_pool_evict(fg->m_buffer_pool, fg->m_destroy_buffer, ctxt, fg->m_frame_index, true);
+        }
+
+        static FgPass s_fg_open_pass(Fg* fg, const char* name, FgExecuteFn execute, s16 final, FgQueue queue)
+        {
+            ASSERT(queue < FgQueueCount);
             ASSERT(fg->m_current_passinfo == nullptr);
 
             FgPassInfo* pi   = &fg->m_passinfo_array[fg->m_pass_array_size];
             pi->m_name       = name;
             pi->m_execute_fn = execute;
             pi->m_final      = final;
+            pi->m_queue      = queue;
             pi->m_flags      = 0;
-            pi->m_ref_count  = 0;
             for (s32 i = FgCreate; i <= FgWrite; ++i)
             {
                 pi->m_texture[i].reset(fg->m_textureinfo_cursor[i]);
@@ -170,45 +862,102 @@ namespace ncore
 
             fg->m_pass_array_size++;
             fg->m_current_passinfo = pi;
+            fg->m_structure_hash   = s_hash_mix(fg->m_structure_hash, (1ull << 60) | ((u64)queue << 8) | (u64)final);
             return pi;
         }
 
-        FgPass fg_open_pass(Fg* fg, const char* name, FgExecuteFn execute) { return s_fg_open_pass(fg, name, execute, 0); }
-        FgPass fg_final_pass(Fg* fg, const char* name, FgExecuteFn execute) { return s_fg_open_pass(fg, name, execute, 1); }
+        FgPass  fg_open_pass(Fg* fg, const char* name, FgExecuteFn execute, FgQueue queue) { return s_fg_open_pass(fg, name, execute, 0, queue); }
+        FgPass  fg_final_pass(Fg* fg, const char* name, FgExecuteFn execute, FgQueue queue) { return s_fg_open_pass(fg, name, execute, 1, queue); }
+        FgQueue fg_get_queue(Fg*, FgPass pass) { return pass->m_queue; }
+        s32     fg_get_subpass(Fg*, FgPass pass) { return pass->m_subpass; }
+
+        void* fg_allocate_pass_data(Fg* fg, u32 size, u32 alignment) { return s_arena_allocate(fg->m_pass_data, size, alignment); }
 
         void fg_close_pass(Fg* fg)
         {
             ASSERT(fg->m_current_passinfo != nullptr);
+            fg->m_structure_hash   = s_hash_mix(fg->m_structure_hash, (8ull << 60) | fg->m_current_passinfo->m_flags);
             fg->m_current_passinfo = nullptr;
         }
 
+        // An imported resource has no producer, it is not part of any create range and thus never created or
+        // destroyed. Its versions inherit the IMPORTED flag, see fg_write.
         FgTexture fg_import(Fg* fg, const char* name, GfxTexture* resource, GfxTextureDescr* descr)
         {
-            // ...
-            // ti->m_resource.m_flags     = IMPORTED;
+            ASSERT(fg->m_textureinfo_cursor_main < fg->m_resource_array_capacity);
 
-            return s_invalid_texture;
+            FgIndex& main = fg->m_textureinfo_cursor_main;
+            s_resource_set(fg->m_resources, fg->texture_row(main), name, c_no_pass, IMPORTED, main, 0, resource, descr);
+
+            fg->m_textureinfo_flags[main] = s_flags_ignored;
+            fg->m_structure_hash          = s_hash_mix(fg->m_structure_hash, (10ull << 60) | main);
+
+            FgTexture texture;
+            texture.index      = main++;
+            texture.generation = fg->m_resource_generation;
+            return texture;
         }
 
         FgBuffer fg_import(Fg* fg, const char* name, GfxBuffer* resource, GfxBufferDescr* descr)
         {
-            // ...
-            // ti->m_resource.m_flags     = IMPORTED;
+            ASSERT(fg->m_bufferinfo_cursor_main < fg->m_resource_array_capacity);
 
-            return s_invalid_buffer;
+            FgIndex& main = fg->m_bufferinfo_cursor_main;
+            s_resource_set(fg->m_resources, fg->buffer_row(main), name, c_no_pass, IMPORTED, main, 0, resource, descr);
+
+            fg->m_bufferinfo_flags[main] = s_flags_ignored;
+            fg->m_structure_hash         = s_hash_mix(fg->m_structure_hash, (11ull << 60) | main);
+
+            FgBuffer buffer;
+            buffer.index      = main++;
+            buffer.generation = fg->m_resource_generation;
+            return buffer;
+        }
+
+        FgHistory fg_create_history(Fg* fg, const char* name, GfxTexture* a, GfxTexture* b, GfxTextureDescr* descr)
+        {
+            ASSERT(fg->m_history_count < c_max_history);
+
+            FgHistoryInfo* history   = &fg->m_history[fg->m_history_count];
+            history->m_name          = name;
+            history->m_texture[0]    = a;
+            history->m_texture[1]    = b;
+            history->m_descr         = descr;
+            history->m_frames        = 0;
+            history->m_current       = 0;
+            history->m_generation[0] = ~0u;
+            history->m_generation[1] = ~0u;
+
+            FgHistory handle;
+            handle.index = (s16)fg->m_history_count++;
+            return handle;
+        }
+
+        static FgTexture s_history_import(Fg* fg, FgHistory _history, s32 slot)
+        {
+            ASSERT(_history.index >= 0 && _history.index < fg->m_history_count);
+            FgHistoryInfo* history = &fg->m_history[_history.index];
+            if (history->m_generation[slot] != fg->m_resource_generation)
+            {
+                history->m_index[slot]      = fg_import(fg, history->m_name, history->m_texture[slot], history->m_descr).index;
+                history->m_generation[slot] = fg->m_resource_generation;
+            }
+
+            FgTexture texture;
+            texture.index      = history->m_index[slot];
+            texture.generation = fg->m_resource_generation;
+            return texture;
         }
 
+        FgTexture fg_history_current(Fg* fg, FgHistory history) { return s_history_import(fg, history, fg->m_history[history.index].m_current); }
+        FgTexture fg_history_previous(Fg* fg, FgHistory history) { return s_history_import(fg, history, fg->m_history[history.index].m_current ^ 1); }
+        bool      fg_history_valid(Fg* fg, FgHistory history) { return fg->m_history[history.index].m_frames > 0; }
+
         FgTexture fg_create(Fg* fg, const char* name, GfxTexture* textureObject, GfxTextureDescr* textureDescr)
         {
-            FgIndex&       main        = fg->m_textureinfo_cursor_main;
-            FgTextureInfo* ti          = &fg->m_textureinfo_array[main];
-            ti->m_resource.m_name      = name;
-            ti->m_resource.m_pass      = fg->m_current_passinfo;
-            ti->m_resource.m_last      = nullptr;
-            ti->m_resource.m_ref_count = 0;
-            ti->m_resource.m_flags     = 0;
-            ti->m_texture              = textureObject;
-            ti->m_textureDescr         = textureDescr;
+            FgIndex&  main   = fg->m_textureinfo_cursor_main;
+            u32 const access = fg->access_stamp(fg->m_current_passinfo) | (1 << FgCreate);
+            s_resource_set(fg->m_resources, fg->texture_row(main), name, fg->pass_index(fg->m_current_passinfo), TRANSIENT, main, access, textureObject, textureDescr);
 
             FgType const type  = FgCreate;
             FgFlags&     flags = fg->m_textureinfo_flags[main];
@@ -218,20 +967,39 @@ namespace ncore
 
             flags = s_flags_ignored;
             range.add(index);
+            fg->m_textureinfo_crw_flags[type][index] = flags;
+            fg->m_textureinfo_crw_range[type][index] = s_subresource_all;
             array[index++] = main++;
 
+            fg->m_structure_hash = s_hash_mix(fg->m_structure_hash, 2ull << 60);
+
             FgTexture texture;
             texture.index      = main - 1;
             texture.generation = fg->m_resource_generation;
             return texture;
         }
 
-        FgTexture fg_read(Fg* fg, FgTexture _texture, FgFlags _descr)
+        // Does the pass read the texture version, in subresources that overlap (or contain) 'subresource', only visits
+        // the read entries of the version in the pass
+        static bool s_pass_reads(Fg* fg, FgPass pass, FgTexture texture, FgSubresource const& subresource, bool contain)
+        {
+            if (!fg->pass_contains(pass, FgRead, texture))
+                return false;
+            for (FgIndex j = fg->m_textureinfo_read_last[texture.index]; j != c_no_entry; j = fg->m_textureinfo_read_prev[j])
+            {
+                FgSubresource const& read = fg->m_textureinfo_crw_range[FgRead][j];
+                if (contain ? s_subresource_contains(read, subresource) : s_subresource_overlaps(read, subresource))
+                    return true;
+            }
+            return false;
+        }
+
+        FgTexture fg_read(Fg* fg, FgTexture _texture, FgFlags _descr, FgSubresource _subresource)
         {
             ASSERT(fg->is_valid(_texture));
             ASSERT(!fg->pass_contains(fg->m_current_passinfo, FgWrite, _texture));
             ASSERT(!fg->pass_contains(fg->m_current_passinfo, FgCreate, _texture));
-            if (!fg->pass_contains(fg->m_current_passinfo, FgRead, _texture))
+            if (!s_pass_reads(fg, fg->m_current_passinfo, _texture, _subresource, true))
             {
                 FgType const type  = FgRead;
                 FgFlags&     flags = fg->m_textureinfo_flags[_texture.index];
@@ -241,18 +1009,29 @@ namespace ncore
 
                 flags = _descr;
                 range.add(index);
+                fg->m_textureinfo_crw_flags[type][index]    = flags;
+                fg->m_textureinfo_crw_range[type][index]    = _subresource;
+                fg->m_textureinfo_read_prev[index]          = fg->pass_contains(fg->m_current_passinfo, type, _texture) ? fg->m_textureinfo_read_last[_texture.index] : c_no_entry;
+                fg->m_textureinfo_read_last[_texture.index] = index;
                 array[index] = _texture.index;
                 index++;
+
+                fg->pass_mark(fg->m_current_passinfo, type, _texture);
+                fg->m_structure_hash = s_hash_mix(fg->m_structure_hash, (4ull << 60) | ((u64)_descr.m_descr << 16) | _texture.index);
+                fg->m_structure_hash = s_hash_mix(fg->m_structure_hash, s_subresource_key(_subresource));
             }
             return _texture;
         }
 
-        FgTexture fg_write(Fg* fg, FgTexture _texture, FgFlags _descr)
+        FgTexture fg_write(Fg* fg, FgTexture _texture, FgFlags _descr, FgSubresource _subresource)
         {
             ASSERT(fg->is_valid(_texture));
-            ASSERT(!fg->pass_contains(fg->m_current_passinfo, FgRead, _texture));
+            ASSERT(!s_pass_reads(fg, fg->m_current_passinfo, _texture, _subresource, false));
             if (fg->pass_contains(fg->m_current_passinfo, FgCreate, _texture))
             {
+                if (fg->pass_contains(fg->m_current_passinfo, FgWrite, _texture))
+                    return _texture;
+
                 FgType const type  = FgWrite;
                 FgFlags&     flags = fg->m_textureinfo_flags[_texture.index];
                 FgRange&     range = fg->m_current_passinfo->m_texture[type];
@@ -261,30 +1040,29 @@ namespace ncore
 
                 flags = _descr;
                 range.add(index);
+                fg->m_textureinfo_crw_flags[type][index] = flags;
+                fg->m_textureinfo_crw_range[type][index] = _subresource;
                 array[index++] = _texture.index;
-
-                FgTextureInfo const* si = &fg->m_textureinfo_array[_texture.index];
-                fg->m_current_passinfo->m_flags |= si->m_resource.m_flags & IMPORTED;
+                fg->pass_mark(fg->m_current_passinfo, type, _texture);
+                fg->m_structure_hash = s_hash_mix(fg->m_structure_hash, (6ull << 60) | ((u64)_descr.m_descr << 16) | _texture.index);
+                fg->m_structure_hash = s_hash_mix(fg->m_structure_hash, s_subresource_key(_subresource));
 
                 return _texture;
             }
             else
             {
-                // Also mark the texture as read
-                fg_read(fg, _texture, s_flags_ignored);
+                // Also mark the (written subresources of the) texture as read
+                fg_read(fg, _texture, s_flags_ignored, _subresource);
 
-                // Clone FgTextureInfo
-                FgTextureInfo const* si = &fg->m_textureinfo_array[_texture.index];
+                // Clone the incoming version
+                FgResourceTable& table  = fg->m_resources;
+                u32 const        source = fg->texture_row(_texture.index);
+                if ((table.m_flags[source] & IMPORTED) == IMPORTED)
+                    fg->m_current_passinfo->m_flags |= HAS_SIDE_EFFECTS;
 
-                FgIndex&       main        = fg->m_textureinfo_cursor_main;
-                FgTextureInfo* ti          = &fg->m_textureinfo_array[main];
-                ti->m_resource.m_name      = si->m_resource.m_name;
-                ti->m_resource.m_pass      = fg->m_current_passinfo;
-                ti->m_resource.m_last      = nullptr;
-                ti->m_resource.m_ref_count = 0;
-                ti->m_resource.m_flags     = si->m_resource.m_flags;
-                ti->m_texture              = si->m_texture;
-                ti->m_textureDescr         = si->m_textureDescr;
+                FgIndex&  main   = fg->m_textureinfo_cursor_main;
+                u32 const access = fg->access_stamp(fg->m_current_passinfo) | (1 << FgWrite);
+                s_resource_set(table, fg->texture_row(main), table.m_name[source], fg->pass_index(fg->m_current_passinfo), table.m_flags[source] & ~CLEAR, table.m_root[source], access, table.m_object[source], table.m_descr[source]);
 
                 FgType const type  = FgWrite;
                 FgFlags&     flags = fg->m_textureinfo_flags[main];
@@ -294,10 +1072,15 @@ namespace ncore
 
                 flags = _descr;
                 range.add(index);
+                fg->m_textureinfo_crw_flags[type][index] = flags;
+                fg->m_textureinfo_crw_range[type][index] = _subresource;
                 array[index] = main;
                 index++;
                 main++;
 
+                fg->m_structure_hash = s_hash_mix(fg->m_structure_hash, (6ull << 60) | ((u64)_descr.m_descr << 16) | (main - 1));
+                fg->m_structure_hash = s_hash_mix(fg->m_structure_hash, s_subresource_key(_subresource));
+
                 FgTexture texture;
                 texture.index      = main - 1;
                 texture.generation = fg->m_resource_generation;
@@ -307,16 +1090,25 @@ namespace ncore
             return s_invalid_texture;
         }
 
+        void fg_clear(Fg* fg, FgTexture _texture)
+        {
+            ASSERT(fg->is_valid(_texture));
+            ASSERT(fg->pass_contains(fg->m_current_passinfo, FgWrite, _texture));
+            fg->m_resources.m_flags[fg->texture_row(_texture.index)] |= CLEAR;
+            fg->m_structure_hash = s_hash_mix(fg->m_structure_hash, (9ull << 60) | _texture.index);
+        }
+
+        FgAttachmentOps fg_get_attachment_ops(Fg* fg, FgTexture _texture)
+        {
+            ASSERT(fg->is_valid(_texture));
+            return fg->m_textureinfo_ops[_texture.index];
+        }
+
         FgBuffer fg_create(Fg* fg, const char* name, GfxBuffer* bufferObject, GfxBufferDescr* bufferDescr)
         {
-            FgIndex&      main         = fg->m_bufferinfo_cursor_main;
-            FgBufferInfo* bi           = &fg->m_bufferinfo_array[main];
-            bi->m_resource.m_name      = name;
-            bi->m_resource.m_pass      = fg->m_current_passinfo;
-            bi->m_resource.m_last      = nullptr;
-            bi->m_resource.m_ref_count = 0;
-            bi->m_buffer               = bufferObject;
-            bi->m_bufferDescr          = bufferDescr;
+            FgIndex&  main   = fg->m_bufferinfo_cursor_main;
+            u32 const access = fg->access_stamp(fg->m_current_passinfo) | (1 << FgCreate);
+            s_resource_set(fg->m_resources, fg->buffer_row(main), name, fg->pass_index(fg->m_current_passinfo), TRANSIENT, main, access, bufferObject, bufferDescr);
 
             FgType const type  = FgCreate;
             FgFlags&     flags = fg->m_bufferinfo_flags[main];
@@ -326,10 +1118,13 @@ namespace ncore
 
             flags = s_flags_ignored;
             range.add(index);
+            fg->m_bufferinfo_crw_flags[type][index] = flags;
             array[index] = main;
             index++;
             main++;
 
+            fg->m_structure_hash = s_hash_mix(fg->m_structure_hash, 3ull << 60);
+
             FgBuffer fb;
             fb.index      = main - 1;
             fb.generation = fg->m_resource_generation;
@@ -352,8 +1147,12 @@ namespace ncore
 
                 flags = _descr;
                 range.add(index);
+                fg->m_bufferinfo_crw_flags[type][index] = flags;
                 array[index] = _buffer.index;
                 index++;
+
+                fg->pass_mark(fg->m_current_passinfo, type, _buffer);
+                fg->m_structure_hash = s_hash_mix(fg->m_structure_hash, (5ull << 60) | ((u64)_descr.m_descr << 16) | _buffer.index);
             }
             return _buffer;
         }
@@ -364,8 +1163,9 @@ namespace ncore
 
             if (fg->pass_contains(fg->m_current_passinfo, FgCreate, _buffer))
             {
-                FgBufferInfo const* si = &fg->m_bufferinfo_array[_buffer.index];
-                fg->m_current_passinfo->m_flags |= si->m_resource.m_flags & IMPORTED;
+                if (fg->pass_contains(fg->m_current_passinfo, FgWrite, _buffer))
+                    return _buffer;
+
 
                 FgType const type  = FgWrite;
                 FgFlags&     flags = fg->m_bufferinfo_flags[_buffer.index];
@@ -375,8 +1175,11 @@ namespace ncore
 
                 flags = _descr;
                 range.add(index);
+                fg->m_bufferinfo_crw_flags[type][index] = flags;
                 array[index] = _buffer.index;
                 index++;
+                fg->pass_mark(fg->m_current_passinfo, type, _buffer);
+                fg->m_structure_hash = s_hash_mix(fg->m_structure_hash, (7ull << 60) | ((u64)_descr.m_descr << 16) | _buffer.index);
 
                 return _buffer;
             }
@@ -384,19 +1187,15 @@ namespace ncore
             {
                 fg_read(fg, _buffer, s_flags_ignored);
 
-                // Clone the incoming FgBufferInfo
-                FgBufferInfo const* si = &fg->m_bufferinfo_array[_buffer.index];
+                // Clone the incoming version
+                FgResourceTable& table  = fg->m_resources;
+                u32 const        source = fg->buffer_row(_buffer.index);
+                if ((table.m_flags[source] & IMPORTED) == IMPORTED)
+                    fg->m_current_passinfo->m_flags |= HAS_SIDE_EFFECTS;
 
-                // New FgBufferInfo
-                FgIndex&      main         = fg->m_bufferinfo_cursor_main;
-                FgBufferInfo* bi           = &fg->m_bufferinfo_array[main];
-                bi->m_resource.m_name      = si->m_resource.m_name;
-                bi->m_resource.m_pass      = fg->m_current_passinfo;
-                bi->m_resource.m_last      = nullptr;
-                bi->m_resource.m_ref_count = 0;
-                bi->m_resource.m_flags     = si->m_resource.m_flags;
-                bi->m_buffer               = si->m_buffer;
-                bi->m_bufferDescr          = si->m_bufferDescr;
+                FgIndex&  main   = fg->m_bufferinfo_cursor_main;
+                u32 const access = fg->access_stamp(fg->m_current_passinfo) | (1 << FgWrite);
+                s_resource_set(table, fg->buffer_row(main), table.m_name[source], fg->pass_index(fg->m_current_passinfo), table.m_flags[source], table.m_root[source], access, table.m_object[source], table.m_descr[source]);
 
                 FgType const type  = FgWrite;
                 FgFlags&     flags = fg->m_bufferinfo_flags[main];
@@ -406,10 +1205,13 @@ namespace ncore
 
                 flags = _descr;
                 range.add(index);
+                fg->m_bufferinfo_crw_flags[type][index] = flags;
                 array[index] = main;
                 index++;
                 main++;
 
+                fg->m_structure_hash = s_hash_mix(fg->m_structure_hash, (7ull << 60) | ((u64)_descr.m_descr << 16) | (main - 1));
+
                 FgBuffer buffer;
                 buffer.index      = main - 1;
                 buffer.generation = fg->m_resource_generation;
@@ -419,286 +1221,3144 @@ namespace ncore
             return s_invalid_buffer;
         }
 
-        GfxTexture*      fg_get(Fg* fg, FgTexture resource) { return fg->m_textureinfo_array[resource.index].m_texture; }
-        GfxBuffer*       fg_get(Fg* fg, FgBuffer resource) { return fg->m_bufferinfo_array[resource.index].m_buffer; }
-        GfxTextureDescr* fg_getDescr(Fg* fg, FgTexture resource) { return fg->m_textureinfo_array[resource.index].m_textureDescr; }
-        GfxBufferDescr*  fg_getDescr(Fg* fg, FgBuffer resource) { return fg->m_bufferinfo_array[resource.index].m_bufferDescr; }
-        FgFlags          fg_getFlags(Fg* fg, FgTexture resource) { return fg->m_textureinfo_flags[resource.index]; }
-        FgFlags          fg_getFlags(Fg* fg, FgBuffer resource) { return fg->m_bufferinfo_flags[resource.index]; }
+        // Recorded declarations, replayed by fg_merge
+        static const u8 c_op_open   = 0;
+        static const u8 c_op_final  = 1;
+        static const u8 c_op_close  = 2;
+        static const u8 c_op_create = 3;
+        static const u8 c_op_read   = 4;
+        static const u8 c_op_write  = 5;
+        static const u8 c_op_clear  = 6;
 
-        void fg_compile(Fg* fg, alloc_t* allocator)
+        struct FgRecordedOp
         {
-            ASSERT(fg->m_current_passinfo == nullptr);
-
-            if ((fg->m_pass_array_size == 0) && (fg->m_textureinfo_cursor_main == 0) && (fg->m_bufferinfo_cursor_main == 0))
-                return;
+            u8            m_op;
+            u8            m_buffer;     // the op is on a buffer
+            FgIndex       m_index;      // open: the recorded pass, create: the recorded resource, else the handle index
+            FgGeneration  m_generation; // of the handle, c_recorded_generation for a version of the recorder
+            FgIndex       m_version;    // create and write: the version of the recorder they make
+            FgFlags       m_flags;
+            FgSubresource m_range;
+        };
 
-            // Reset ref-counts
-            for (s32 i = 0; i < fg->m_textureinfo_cursor[FgCreate]; ++i)
-            {
-                FgResourceInfo* resource = &fg->m_textureinfo_array[i].m_resource;
-                resource->m_ref_count    = 0;
-            }
-            for (s32 i = 0; i < fg->m_bufferinfo_cursor[FgCreate]; ++i)
-            {
-                FgResourceInfo* resource = &fg->m_bufferinfo_array[i].m_resource;
-                resource->m_ref_count    = 0;
-            }
+        struct FgRecordedPass
+        {
+            const char* m_name;
+            FgExecuteFn m_execute;
+            FgQueue     m_queue;
+        };
 
-            // Calculate ref-counts of resources used by passes
-            {
-                for (s32 i = 0; i < fg->m_pass_array_size; ++i)
+        struct FgRecordedResource
+        {
+            const char* m_name;
+            void*       m_object;
+            void*       m_descr;
+        };
+
+        struct FgRecorder
+        {
+            DCORE_CLASS_PLACEMENT_NEW_DELETE
+
+            Fg*                 m_fg;
+            u32                 m_op_capacity;
+            u32                 m_op_count;
+            FgRecordedOp*       m_ops;
+            u32                 m_pass_capacity;
+            u32                 m_pass_count;
+            FgRecordedPass*     m_passes;
+            u32                 m_resource_count; // one per create, at most 'm_op_capacity'
+            FgRecordedResource* m_resources;
+            FgIndex             m_version_count[2]; // textures and buffers, the versions made by the recorder
+            FgIndex*            m_remap[2];         // textures and buffers, per version of the recorder its index in the graph
+            FgGeneration        m_generation;       // the resource generation of the graph it was merged into
+            bool                m_open;
+            bool                m_merged;
+            FgPassDataArena     m_pass_data;
+        };
+
+        FgRecorder* fg_recorder_setup(Fg* fg, u32 op_capacity, u32 pass_capacity, u32 pass_data_capacity)
+        {
+            ASSERT(op_capacity < c_no_pass);
+
+            FgRecorder* recorder      = g_allocate_and_clear<FgRecorder>(fg->m_allocator);
+            recorder->m_fg            = fg;
+            recorder->m_op_capacity   = op_capacity;
+            recorder->m_ops           = g_allocate_array_and_clear<FgRecordedOp>(fg->m_allocator, op_capacity);
+            recorder->m_pass_capacity = pass_capacity;
+            recorder->m_passes        = g_allocate_array_and_clear<FgRecordedPass>(fg->m_allocator, pass_capacity);
+            recorder->m_resources     = g_allocate_array_and_clear<FgRecordedResource>(fg->m_allocator, op_capacity);
+            recorder->m_remap[0]      = g_allocate_array_and_clear<FgIndex>(fg->m_allocator, op_capacity);
+            recorder->m_remap[1]      = g_allocate_array_and_clear<FgIndex>(fg->m_allocator, op_capacity);
+            s_arena_setup(fg->m_allocator, recorder->m_pass_data, pass_data_capacity);
+            return recorder;
+        }
+
+        void fg_recorder_teardown(FgRecorder*& recorder)
+        {
+            alloc_t* allocator = recorder->m_fg->m_allocator;
+            g_deallocate_array(allocator, recorder->m_ops);
+            g_deallocate_array(allocator, recorder->m_passes);
+            g_deallocate_array(allocator, recorder->m_resources);
+            g_deallocate_array(allocator, recorder->m_remap[0]);
+            g_deallocate_array(allocator, recorder->m_remap[1]);
+            s_arena_teardown(allocator, recorder->m_pass_data);
+            g_deallocate(allocator, recorder);
+            recorder = nullptr;
+        }
+
+        void fg_recorder_reset(FgRecorder* recorder)
+        {
+            ASSERT(!recorder->m_open);
+            recorder->m_op_count           = 0;
+            recorder->m_pass_count         = 0;
+            recorder->m_resource_count     = 0;
+            recorder->m_version_count[0]   = 0;
+            recorder->m_version_count[1]   = 0;
+            recorder->m_merged             = false;
+            recorder->m_pass_data.m_cursor = 0;
+        }
+
+        static FgRecordedOp* s_record(FgRecorder* recorder, u8 op, u8 buffer, FgIndex index, FgGeneration generation)
+        {
+            ASSERT(!recorder->m_merged && recorder->m_op_count < recorder->m_op_capacity);
+            FgRecordedOp* recorded = &recorder->m_ops[recorder->m_op_count++];
+            recorded->m_op         = op;
+            recorded->m_buffer     = buffer;
+            recorded->m_index      = index;
+            recorded->m_generation = generation;
+            recorded->m_version    = 0;
+            recorded->m_flags      = s_flags_ignored;
+            recorded->m_range      = s_subresource_all;
+            return recorded;
+        }
+
+        // A handle of the recorder, or of the graph. The graph may be declared on another thread while the recorder is
+        // used, so its handles are not checked here but by fg_merge when it declares the access in the graph.
+        static bool s_recorded_valid(FgRecorder* recorder, u8 buffer, FgIndex index, FgGeneration generation)
+        {
+            if (generation == c_recorded_generation)
+                return index < recorder->m_version_count[buffer];
+            return true;
+        }
+
+        static void s_record_pass(FgRecorder* recorder, u8 op, const char* name, FgExecuteFn execute, FgQueue queue)
+        {
+            ASSERT(!recorder->m_open && recorder->m_pass_count < recorder->m_pass_capacity);
+            FgRecordedPass* pass = &recorder->m_passes[recorder->m_pass_count];
+            pass->m_name         = name;
+            pass->m_execute      = execute;
+            pass->m_queue        = queue;
+            s_record(recorder, op, 0, (FgIndex)recorder->m_pass_count++, 0);
+            recorder->m_open = true;
+        }
+
+        void fg_open_pass(FgRecorder* recorder, const char* name, FgExecuteFn execute, FgQueue queue) { s_record_pass(recorder, c_op_open, name, execute, queue); }
+        void fg_final_pass(FgRecorder* recorder, const char* name, FgExecuteFn execute, FgQueue queue) { s_record_pass(recorder, c_op_final, name, execute, queue); }
+
+        void fg_close_pass(FgRecorder* recorder)
+        {
+            ASSERT(recorder->m_open);
+            s_record(recorder, c_op_close, 0, 0, 0);
+            recorder->m_open = false;
+        }
+
+        void* fg_allocate_pass_data(FgRecorder* recorder, u32 size, u32 alignment) { return s_arena_allocate(recorder->m_pass_data, size, alignment); }
+
+        static FgIndex s_record_create(FgRecorder* recorder, u8 buffer, const char* name, void* object, void* descr)
+        {
+            ASSERT(recorder->m_open);
+            FgRecordedResource* resource = &recorder->m_resources[recorder->m_resource_count];
+            resource->m_name             = name;
+            resource->m_object           = object;
+            resource->m_descr            = descr;
+
+            FgRecordedOp* op = s_record(recorder, c_op_create, buffer, (FgIndex)recorder->m_resource_count++, 0);
+            op->m_version    = recorder->m_version_count[buffer]++;
+            return op->m_version;
+        }
+
+        static FgIndex s_record_access(FgRecorder* recorder, u8 op_type, u8 buffer, FgIndex index, FgGeneration generation, FgFlags flags, FgSubresource range)
+        {
+            ASSERT(recorder->m_open);
+            ASSERT(s_recorded_valid(recorder, buffer, index, generation));
+
+            FgRecordedOp* op = s_record(recorder, op_type, buffer, index, generation);
+            op->m_flags      = flags;
+            op->m_range      = range;
+            if (op_type != c_op_write)
+                return index;
+            op->m_version = recorder->m_version_count[buffer]++;
+            return op->m_version;
+        }
+
+        FgTexture fg_create(FgRecorder* recorder, const char* name, GfxTexture* textureObject, GfxTextureDescr* textureDescr)
+        {
+            FgTexture texture;
+            texture.index      = s_record_create(recorder, 0, name, textureObject, textureDescr);
+            texture.generation = c_recorded_generation;
+            return texture;
+        }
+
+        FgTexture fg_read(FgRecorder* recorder, FgTexture texture, FgFlags descr, FgSubresource range)
+        {
+            s_record_access(recorder, c_op_read, 0, texture.index, texture.generation, descr, range);
+            return texture;
+        }
+
+        FgTexture fg_write(FgRecorder* recorder, FgTexture texture, FgFlags descr, FgSubresource range)
+        {
+            FgTexture version;
+            version.index      = s_record_access(recorder, c_op_write, 0, texture.index, texture.generation, descr, range);
+            version.generation = c_recorded_generation;
+            return version;
+        }
+
+        void fg_clear(FgRecorder* recorder, FgTexture texture) { s_record_access(recorder, c_op_clear, 0, texture.index, texture.generation, s_flags_ignored, s_subresource_all); }
+
+        FgBuffer fg_create(FgRecorder* recorder, const char* name, GfxBuffer* bufferObject, GfxBufferDescr* bufferDescr)
+        {
+            FgBuffer buffer;
+            buffer.index      = s_record_create(recorder, 1, name, bufferObject, bufferDescr);
+            buffer.generation = c_recorded_generation;
+            return buffer;
+        }
+
+        FgBuffer fg_read(FgRecorder* recorder, FgBuffer buffer, FgFlags descr)
+        {
+            s_record_access(recorder, c_op_read, 1, buffer.index, buffer.generation, descr, s_subresource_all);
+            return buffer;
+        }
+
+        FgBuffer fg_write(FgRecorder* recorder, FgBuffer buffer, FgFlags descr)
+        {
+            FgBuffer version;
+            version.index      = s_record_access(recorder, c_op_write, 1, buffer.index, buffer.generation, descr, s_subresource_all);
+            version.generation = c_recorded_generation;
+            return version;
+        }
+
+        FgTexture fg_resolve(FgRecorder* recorder, FgTexture texture)
+        {
+            if (texture.generation == c_recorded_generation)
+            {
+                ASSERT(recorder->m_merged && texture.index < recorder->m_version_count[0]);
+                texture.index      = recorder->m_remap[0][texture.index];
+                texture.generation = recorder->m_generation;
+            }
+            return texture;
+        }
+
+        FgBuffer fg_resolve(FgRecorder* recorder, FgBuffer buffer)
+        {
+            if (buffer.generation == c_recorded_generation)
+            {
+                ASSERT(recorder->m_merged && buffer.index < recorder->m_version_count[1]);
+                buffer.index      = recorder->m_remap[1][buffer.index];
+                buffer.generation = recorder->m_generation;
+            }
+            return buffer;
+        }
+
+        // Replays the recorded declarations, a version of the recorder is always made by an op before the ops that use it
+        static void s_merge(Fg* fg, FgRecorder* recorder)
+        {
+            ASSERT(recorder->m_fg == fg && !recorder->m_open && !recorder->m_merged);
+            recorder->m_generation = (FgGeneration)fg->m_resource_generation;
+            recorder->m_merged     = true;
+
+            for (u32 i = 0; i < recorder->m_op_count; ++i)
+            {
+                FgRecordedOp const* op = &recorder->m_ops[i];
+                FgTexture           texture;
+                FgBuffer            buffer;
+                texture.index      = buffer.index      = op->m_index;
+                texture.generation = buffer.generation = op->m_generation;
+
+                switch (op->m_op)
+                {
+                    case c_op_open:
+                    case c_op_final:
+                    {
+                        FgRecordedPass const* pass = &recorder->m_passes[op->m_index];
+                        if (op->m_op == c_op_final)
+                            fg_final_pass(fg, pass->m_name, pass->m_execute, pass->m_queue);
+                        else
+                            fg_open_pass(fg, pass->m_name, pass->m_execute, pass->m_queue);
+                        break;
+                    }
+                    case c_op_close: fg_close_pass(fg); break;
+                    case c_op_create:
+                    {
+                        FgRecordedResource const* resource = &recorder->m_resources[op->m_index];
+                        if (op->m_buffer)
+                            recorder->m_remap[1][op->m_version] = fg_create(fg, resource->m_name, (GfxBuffer*)resource->m_object, (GfxBufferDescr*)resource->m_descr).index;
+                        else
+                            recorder->m_remap[0][op->m_version] = fg_create(fg, resource->m_name, (GfxTexture*)resource->m_object, (GfxTextureDescr*)resource->m_descr).index;
+                        break;
+                    }
+                    case c_op_read:
+                        if (op->m_buffer)
+                            fg_read(fg, fg_resolve(recorder, buffer), op->m_flags);
+                        else
+                            fg_read(fg, fg_resolve(recorder, texture), op->m_flags, op->m_range);
+                        break;
+                    case c_op_write:
+                        if (op->m_buffer)
+                            recorder->m_remap[1][op->m_version] = fg_write(fg, fg_resolve(recorder, buffer), op->m_flags).index;
+                        else
+                            recorder->m_remap[0][op->m_version] = fg_write(fg, fg_resolve(recorder, texture), op->m_flags, op->m_range).index;
+                        break;
+                    case c_op_clear: fg_clear(fg, fg_resolve(recorder, texture)); break;
+                }
+            }
+        }
+
+        void fg_merge(Fg* fg, FgRecorder** recorders, s32 recorder_count)
+        {
+            ASSERT(fg->m_current_passinfo == nullptr);
+            for (s32 i = 0; i < recorder_count; ++i)
+                s_merge(fg, recorders[i]);
+        }
+
+        bool             fg_is_valid(Fg* fg, FgTexture resource) { return fg->is_valid(resource); }
+        bool             fg_is_valid(Fg* fg, FgBuffer resource) { return fg->is_valid(resource); }
+        GfxTexture*      fg_get(Fg* fg, FgTexture resource) { return fg->physical_texture(resource.index); }
+        GfxBuffer*       fg_get(Fg* fg, FgBuffer resource) { return fg->physical_buffer(resource.index); }
+        GfxTextureDescr* fg_getDescr(Fg* fg, FgTexture resource) { return fg->texture_descr(resource.index); }
+        GfxBufferDescr*  fg_getDescr(Fg* fg, FgBuffer resource) { return fg->buffer_descr(resource.index); }
+        FgFlags          fg_getFlags(Fg* fg, FgTexture resource) { return fg->m_textureinfo_flags[resource.index]; }
+        FgFlags          fg_getFlags(Fg* fg, FgBuffer resource) { return fg->m_bufferinfo_flags[resource.index]; }
+
+        static inline bool s_is_culled(FgPassInfo const* pass) { return pass->m_ref_count == 0 && !((pass->m_flags & HAS_SIDE_EFFECTS) == HAS_SIDE_EFFECTS) && !(pass->m_final == 1); }
+
+        // Atomics used by the parallel execution, the pipeline and the trace
+#if defined(_MSC_VER)
+        static inline s32  s_atomic_add(s32* value, s32 add) { return (s32)_InterlockedExchangeAdd((long volatile*)value, (long)add) + add; }
+        static inline s32  s_atomic_load(s32* value) { return (s32)_InterlockedCompareExchange((long volatile*)value, 0, 0); }
+        static inline void s_atomic_store(s32* value, s32 v) { _InterlockedExchange((long volatile*)value, (long)v); }
+        static inline void s_cpu_pause() { _mm_pause(); }
+#else
+        static inline s32  s_atomic_add(s32* value, s32 add) { return __atomic_add_fetch(value, add, __ATOMIC_ACQ_REL); }
+        static inline s32  s_atomic_load(s32* value) { return __atomic_load_n(value, __ATOMIC_ACQUIRE); }
+        static inline void s_atomic_store(s32* value, s32 v) { __atomic_store_n(value, v, __ATOMIC_RELEASE); }
+#    if defined(__x86_64__) || defined(__i386__)
+        static inline void s_cpu_pause() { __builtin_ia32_pause(); }
+#    else
+        static inline void s_cpu_pause() {}
+#    endif
+#endif
+
+        // A scope of the trace, the event is written to the ring when the scope ends
+        struct FgTraceScope
+        {
+            FgTraceScope(Fg* fg, const char* name, const char* category, s32 thread)
+                : m_fg(fg->m_trace.m_capacity > 0 ? fg : nullptr)
+                , m_name(name)
+                , m_category(category)
+                , m_thread(thread)
+                , m_begin(0)
+            {
+                if (m_fg != nullptr)
+                    m_begin = m_fg->m_trace.m_clock.Call();
+            }
+
+            ~FgTraceScope()
+            {
+                if (m_fg == nullptr)
+                    return;
+                FgTrace&      trace = m_fg->m_trace;
+                u64 const     end   = trace.m_clock.Call();
+                s32 const     slot  = s_atomic_add(&trace.m_cursor, 1) - 1;
+                FgTraceEvent* event = &trace.m_events[(u32)slot % trace.m_capacity];
+                event->m_name       = m_name;
+                event->m_category   = m_category;
+                event->m_begin      = m_begin;
+                event->m_end        = end;
+                event->m_thread     = m_thread;
+            }
+
+            Fg*         m_fg;
+            const char* m_name;
+            const char* m_category;
+            s32         m_thread;
+            u64         m_begin;
+        };
+
+#if FG_TRACE
+#    define FG_TRACE_CONCAT_(a, b)                     a##b
+#    define FG_TRACE_CONCAT(a, b)                      FG_TRACE_CONCAT_(a, b)
+#    define FG_TRACE_SCOPE(fg, name, category, thread) FgTraceScope FG_TRACE_CONCAT(trace_scope_, __LINE__)(fg, name, category, thread)
+#else
+#    define FG_TRACE_SCOPE(fg, name, category, thread) (void)(thread)
+#endif
+
+        struct FgAccessNode
+        {
+            s32           m_pass;
+            s32           m_next;
+            FgSubresource m_range;
+        };
+
+        // The accesses of a physical resource that later accesses depend on
+        struct FgAccessState
+        {
+            s32 m_whole;     // the pass of the last write of the whole resource, -1 when none
+            s32 m_writers;   // the writes of subresources that followed it and that a later write did not cover
+            s32 m_readers;   // the reads of subresources that a later write did not cover
+            s32 m_rewritten; // is a version of the resource written after the one that creates it
+        };
+
+        struct FgDependencyBuilder
+        {
+            alloc_t*       m_allocator;
+            FgAccessState* m_states; // per physical resource
+            FgAccessNode*  m_nodes;
+            s32            m_node_count;
+            s32*           m_stamp; // per pass, the pass for which it was last added as a dependency
+            s32*           m_edge_from;
+            s32*           m_edge_to;
+            s32            m_edge_count;
+            s32            m_edge_max;
+
+            // All the edges of a pass are added while visiting that pass, so the stamp removes every duplicate
+            void add_edge(s32 from, s32 to)
+            {
+                if (from < 0 || from == to || m_stamp[from] == to)
+                    return;
+                if (m_edge_count == m_edge_max)
+                {
+                    m_edge_from = s_grow_array(m_allocator, m_edge_from, m_edge_count, 2 * m_edge_max);
+                    m_edge_to   = s_grow_array(m_allocator, m_edge_to, m_edge_count, 2 * m_edge_max);
+                    m_edge_max *= 2;
+                }
+                m_stamp[from]             = to;
+                m_edge_from[m_edge_count] = from;
+                m_edge_to[m_edge_count]   = to;
+                m_edge_count++;
+            }
+
+            void push(s32* list, s32 pass, FgSubresource const& range)
+            {
+                m_nodes[m_node_count].m_pass  = pass;
+                m_nodes[m_node_count].m_next  = *list;
+                m_nodes[m_node_count].m_range = range;
+                *list                         = m_node_count++;
+            }
+
+            // Depends on the writes that overlap and that no later write covered, only the whole-resource write when no
+            // subresource was written after it. The read is only kept for the write-after-read dependencies when
+            // another write of the resource follows.
+            void read(s32 resource, s32 pass, FgSubresource const& range)
+            {
+                FgAccessState& state = m_states[resource];
+                add_edge(state.m_whole, pass);
+                for (s32 n = state.m_writers; n >= 0; n = m_nodes[n].m_next)
+                {
+                    if (s_subresource_overlaps(m_nodes[n].m_range, range))
+                        add_edge(m_nodes[n].m_pass, pass);
+                }
+                if (state.m_rewritten != 0)
+                    push(&state.m_readers, pass, range);
+            }
+
+            // The accesses that the write fully covers are ordered through this pass from now on and leave the lists, a
+            // write of the whole resource covers all of them and is not kept in a list
+            void write(s32 resource, s32 pass, FgSubresource const& range)
+            {
+                FgAccessState& state = m_states[resource];
+                add_edge(state.m_whole, pass);
+                if (s_subresource_contains(range, s_subresource_all))
+                {
+                    for (s32 n = state.m_readers; n >= 0; n = m_nodes[n].m_next)
+                        add_edge(m_nodes[n].m_pass, pass);
+                    for (s32 n = state.m_writers; n >= 0; n = m_nodes[n].m_next)
+                        add_edge(m_nodes[n].m_pass, pass);
+                    state.m_whole   = pass;
+                    state.m_readers = -1;
+                    state.m_writers = -1;
+                    return;
+                }
+                cover(&state.m_readers, pass, range);
+                cover(&state.m_writers, pass, range);
+                push(&state.m_writers, pass, range);
+            }
+
+            void cover(s32* link, s32 pass, FgSubresource const& range)
+            {
+                while (*link >= 0)
+                {
+                    FgAccessNode const& node = m_nodes[*link];
+                    if (!s_subresource_overlaps(node.m_range, range))
+                    {
+                        link = &m_nodes[*link].m_next;
+                        continue;
+                    }
+                    add_edge(node.m_pass, pass);
+                    if (s_subresource_contains(range, node.m_range))
+                        *link = node.m_next;
+                    else
+                        link = &m_nodes[*link].m_next;
+                }
+            }
+        };
+
+        // The index of the pass that created the (root) resource, -1 for an imported resource
+        static inline s32 s_creator(Fg* fg, u32 root) { return fg->m_resources.m_pass[root] != c_no_pass ? (s32)fg->m_resources.m_pass[root] : -1; }
+
+        // Pass dependencies (read-after-write, write-after-read and write-after-write) between the live passes,
+        // derived from the order in which they access the subresources of the physical resources, every pass that
+        // accesses a resource also depends on the pass that creates it. Stored per pass as a range of successors
+        // into 'm_edge_array' and the number of passes it depends on.
+        static void s_build_dependencies(Fg* fg, alloc_t* allocator)
+        {
+            s32 const texture_count = fg->m_textureinfo_cursor_main;
+            s32 const buffer_count  = fg->m_bufferinfo_cursor_main;
+            s32 const read_count    = fg->m_textureinfo_cursor[FgRead] + fg->m_bufferinfo_cursor[FgRead];
+            s32 const write_count   = fg->m_textureinfo_cursor[FgWrite] + fg->m_bufferinfo_cursor[FgWrite];
+
+            // Overlapping subresource ranges can add more edges than there are accesses, the edges then grow
+            FgDependencyBuilder builder;
+            builder.m_allocator  = allocator;
+            builder.m_states     = g_allocate_array<FgAccessState>(allocator, texture_count + buffer_count + 1);
+            builder.m_nodes      = g_allocate_array<FgAccessNode>(allocator, read_count + write_count + 1);
+            builder.m_node_count = 0;
+            builder.m_stamp      = g_allocate_array<s32>(allocator, fg->m_pass_array_size + 1);
+            builder.m_edge_max   = 2 * (read_count + write_count) + 16;
+            builder.m_edge_from  = g_allocate_array<s32>(allocator, builder.m_edge_max);
+            builder.m_edge_to    = g_allocate_array<s32>(allocator, builder.m_edge_max);
+            builder.m_edge_count = 0;
+            for (s32 i = 0; i < texture_count + buffer_count; ++i)
+                builder.m_states[i] = {-1, -1, -1, 0};
+
+            // A write of a version that is not the root is a write after the one that creates the resource
+            FgIndex const* roots = fg->m_resources.m_root;
+            for (s32 j = 0; j < fg->m_textureinfo_cursor[FgWrite]; ++j)
+            {
+                FgIndex const version = fg->m_textureinfo_crw_array[FgWrite][j];
+                if (roots[fg->texture_row(version)] != version)
+                    builder.m_states[roots[fg->texture_row(version)]].m_rewritten = 1;
+            }
+            for (s32 j = 0; j < fg->m_bufferinfo_cursor[FgWrite]; ++j)
+            {
+                FgIndex const version = fg->m_bufferinfo_crw_array[FgWrite][j];
+                if (roots[fg->buffer_row(version)] != version)
+                    builder.m_states[texture_count + roots[fg->buffer_row(version)]].m_rewritten = 1;
+            }
+
+            for (u32 i = 0; i < fg->m_pass_array_size; ++i)
+            {
+                FgPassInfo* pass     = &fg->m_passinfo_array[i];
+                builder.m_stamp[i]   = -1;
+                pass->m_dependencies = 0;
+                pass->m_successors.reset(0);
+                if (s_is_culled(pass))
+                    continue;
+
+                // Textures are keyed by their root, buffers follow the textures
+                for (s32 j = pass->m_texture[FgRead].begin; j < pass->m_texture[FgRead].end; ++j)
+                {
+                    FgIndex const root = roots[fg->texture_row(fg->m_textureinfo_crw_array[FgRead][j])];
+                    builder.add_edge(s_creator(fg, fg->texture_row(root)), i);
+                    builder.read(root, i, fg->m_textureinfo_crw_range[FgRead][j]);
+                }
+                for (s32 j = pass->m_buffer[FgRead].begin; j < pass->m_buffer[FgRead].end; ++j)
+                {
+                    FgIndex const root = roots[fg->buffer_row(fg->m_bufferinfo_crw_array[FgRead][j])];
+                    builder.add_edge(s_creator(fg, fg->buffer_row(root)), i);
+                    builder.read(texture_count + root, i, s_subresource_all);
+                }
+                for (s32 j = pass->m_texture[FgWrite].begin; j < pass->m_texture[FgWrite].end; ++j)
+                {
+                    FgIndex const root = roots[fg->texture_row(fg->m_textureinfo_crw_array[FgWrite][j])];
+                    builder.add_edge(s_creator(fg, fg->texture_row(root)), i);
+                    builder.write(root, i, fg->m_textureinfo_crw_range[FgWrite][j]);
+                }
+                for (s32 j = pass->m_buffer[FgWrite].begin; j < pass->m_buffer[FgWrite].end; ++j)
+                {
+                    FgIndex const root = roots[fg->buffer_row(fg->m_bufferinfo_crw_array[FgWrite][j])];
+                    builder.add_edge(s_creator(fg, fg->buffer_row(root)), i);
+                    builder.write(texture_count + root, i, s_subresource_all);
+                }
+            }
+
+            if (builder.m_edge_count > (s32)fg->m_edge_capacity)
+            {
+                fg->m_edge_capacity = (u32)builder.m_edge_count * 2;
+                g_deallocate_array(fg->m_allocator, fg->m_edge_array);
+                fg->m_edge_array = g_allocate_array<FgIndex>(fg->m_allocator, fg->m_edge_capacity);
+            }
+
+            // Count per pass, prefix-sum into ranges, then fill
+            for (s32 e = 0; e < builder.m_edge_count; ++e)
+            {
+                fg->m_passinfo_array[builder.m_edge_from[e]].m_successors.end++;
+                fg->m_passinfo_array[builder.m_edge_to[e]].m_dependencies++;
+            }
+            s32 cursor = 0;
+            for (u32 i = 0; i < fg->m_pass_array_size; ++i)
+            {
+                FgRange&  range = fg->m_passinfo_array[i].m_successors;
+                s32 const size  = range.end;
+                range.begin     = cursor;
+                range.end       = cursor;
+                cursor += size;
+            }
+            for (s32 e = 0; e < builder.m_edge_count; ++e)
+                fg->m_edge_array[fg->m_passinfo_array[builder.m_edge_from[e]].m_successors.end++] = (FgIndex)builder.m_edge_to[e];
+
+            g_deallocate_array(allocator, builder.m_edge_to);
+            g_deallocate_array(allocator, builder.m_edge_from);
+            g_deallocate_array(allocator, builder.m_stamp);
+            g_deallocate_array(allocator, builder.m_nodes);
+            g_deallocate_array(allocator, builder.m_states);
+        }
+
+        // Distribute the physical (root) resources over the pass that last uses them, the result is a
+        // compact 'release' range per pass into 'release_array'.
+        static void s_build_release_lists(Fg* fg, u32 row, s32 count, FgPass* last, FgIndex* release_array, FgRange FgPassInfo::* release)
+        {
+            for (u32 i = 0; i < fg->m_pass_array_size; ++i)
+                (fg->m_passinfo_array[i].*release).reset(0);
+
+            // The columns of the rows [row, row + count)
+            FgIndex const* last_pass = fg->m_resources.m_last + row;
+            FgIndex const* roots     = fg->m_resources.m_root + row;
+            u16 const*     queues    = fg->m_resources.m_queues + row;
+            u16 const*     flags     = fg->m_resources.m_flags + row;
+
+            // The last pass that uses any version of a physical resource
+            for (s32 i = 0; i < count; ++i)
+                last[i] = nullptr;
+            for (s32 i = 0; i < count; ++i)
+            {
+                FgPass const pass = fg->pass_at(last_pass[i]);
+                if (pass != nullptr && (last[roots[i]] == nullptr || pass->m_position > last[roots[i]]->m_position))
+                    last[roots[i]] = pass;
+            }
+
+            // A resource used on another queue than the graphics queue can still be in use on the GPU after the
+            // last pass that uses it in execution order, it is kept alive until the end of the frame.
+            FgPass const frame_end = fg->m_order_count > 0 ? &fg->m_passinfo_array[fg->m_order[fg->m_order_count - 1]] : nullptr;
+            for (s32 i = 0; i < count; ++i)
+            {
+                if (last[i] != nullptr && (queues[i] & ~(1 << FgQueueGraphics)) != 0)
+                    last[i] = frame_end;
+            }
+
+            // Count per pass, prefix-sum into ranges, then fill
+            for (s32 i = 0; i < count; ++i)
+            {
+                if (last[i] != nullptr && (flags[i] & TRANSIENT) == TRANSIENT)
+                    (last[i]->*release).end++;
+            }
+            s32 cursor = 0;
+            for (u32 i = 0; i < fg->m_pass_array_size; ++i)
+            {
+                FgRange& range = fg->m_passinfo_array[i].*release;
+                s32 const size = range.end;
+                range.begin    = cursor;
+                range.end      = cursor;
+                cursor += size;
+            }
+            for (s32 i = 0; i < count; ++i)
+            {
+                if (last[i] != nullptr && (flags[i] & TRANSIENT) == TRANSIENT)
+                    release_array[(last[i]->*release).end++] = (FgIndex)i;
+            }
+        }
+
+        // Cross-queue synchronization. A pass has to wait for its latest dependency on every other queue, unless the
+        // queue of the pass already knows about it, directly or through an earlier wait. Every queue keeps a vector with
+        // per queue the timeline value it has synchronized with, a wait merges the vector of the pass it waits for.
+        static void s_build_queue_sync(Fg* fg, alloc_t* allocator)
+        {
+            s32* latest    = g_allocate_array<s32>(allocator, FgQueueCount * fg->m_pass_array_size); // per pass and queue, the latest dependency on that queue
+            u32* knowledge = g_allocate_array<u32>(allocator, FgQueueCount * fg->m_pass_array_size); // per pass, the vector of its queue after the pass
+
+            u32 value[FgQueueCount] = {0};
+            for (u32 i = 0; i < fg->m_pass_array_size; ++i)
+            {
+                FgPassInfo* pass = &fg->m_passinfo_array[i];
+                pass->m_value    = 0;
+                pass->m_signal   = false;
+                pass->m_waits.reset(0);
+                for (s32 q = 0; q < FgQueueCount; ++q)
+                    latest[i * FgQueueCount + q] = -1;
+            }
+            for (s32 k = 0; k < fg->m_order_count; ++k)
+            {
+                s32 const   i    = fg->m_order[k];
+                FgPassInfo* pass = &fg->m_passinfo_array[i];
+                pass->m_value    = ++value[pass->m_queue];
+                for (s32 j = pass->m_successors.begin; j < pass->m_successors.end; ++j)
+                {
+                    FgIndex const successor = fg->m_edge_array[j];
+                    if (fg->m_passinfo_array[successor].m_queue != pass->m_queue)
+                        latest[successor * FgQueueCount + pass->m_queue] = i;
+                }
+            }
+
+            u32 known[FgQueueCount][FgQueueCount] = {{0}};
+            s32 cursor                            = 0;
+            for (s32 k = 0; k < fg->m_order_count; ++k)
+            {
+                s32 const   i    = fg->m_order[k];
+                FgPassInfo* pass = &fg->m_passinfo_array[i];
+                pass->m_waits.reset(cursor);
+
+                // The dependencies the queue does not know about yet
+                u32* const queue = known[pass->m_queue];
+                s32        wait[FgQueueCount];
+                for (s32 q = 0; q < FgQueueCount; ++q)
+                {
+                    s32 const other = latest[i * FgQueueCount + q];
+                    wait[q]         = (other >= 0 && fg->m_passinfo_array[other].m_value > queue[q]) ? other : -1;
+                }
+
+                // Drop a wait that is implied by waiting for another queue
+                for (s32 q = 0; q < FgQueueCount; ++q)
+                {
+                    for (s32 r = 0; r < FgQueueCount && wait[q] >= 0; ++r)
+                    {
+                        if (r != q && wait[r] >= 0 && knowledge[wait[r] * FgQueueCount + q] >= fg->m_passinfo_array[wait[q]].m_value)
+                            wait[q] = -1;
+                    }
+                }
+
+                for (s32 q = 0; q < FgQueueCount; ++q)
+                {
+                    if (wait[q] < 0)
+                        continue;
+                    FgPassInfo* other          = &fg->m_passinfo_array[wait[q]];
+                    other->m_signal            = true;
+                    fg->m_sync_array[cursor++] = {(FgQueue)q, other->m_value};
+                    for (s32 r = 0; r < FgQueueCount; ++r)
+                    {
+                        if (knowledge[wait[q] * FgQueueCount + r] > queue[r])
+                            queue[r] = knowledge[wait[q] * FgQueueCount + r];
+                    }
+                }
+                pass->m_waits.end    = cursor;
+                queue[pass->m_queue] = pass->m_value;
+                for (s32 q = 0; q < FgQueueCount; ++q)
+                    knowledge[i * FgQueueCount + q] = queue[q];
+            }
+
+            g_deallocate_array(allocator, knowledge);
+            g_deallocate_array(allocator, latest);
+        }
+
+        // The last usage of a range of subresources of a physical resource while walking the live passes in execution order
+        struct FgUsage
+        {
+            FgFlags       m_flags;
+            s32           m_pass; // index of the pass that last accessed the subresources
+            bool          m_read;
+            FgSubresource m_range;
+            s32           m_next; // the next usage of the same physical resource, or the next free usage
+        };
+
+        // Per physical resource a list of usages with disjoint subresource ranges that together cover the resource, the
+        // list of a resource that has not been accessed yet is empty
+        struct FgUsageList
+        {
+            alloc_t* m_allocator;
+            FgUsage* m_usages;
+            s32*     m_head;
+            s32      m_free;
+            s32      m_count;
+            s32      m_capacity;
+
+            void setup(alloc_t* allocator, s32 resource_count, s32 access_count)
+            {
+                // An access replaces every usage it overlaps with itself and at most four remainders per usage, the
+                // usages grow when the ranges of many accesses fragment a resource
+                m_allocator = allocator;
+                m_capacity  = resource_count + 8 * access_count + 1;
+                m_usages    = g_allocate_array<FgUsage>(allocator, m_capacity);
+                m_head      = g_allocate_array<s32>(allocator, resource_count + 1);
+                m_free      = -1;
+                m_count     = 0;
+                for (s32 i = 0; i < resource_count; ++i)
+                    m_head[i] = -1;
+            }
+
+            void teardown(alloc_t* allocator)
+            {
+                g_deallocate_array(allocator, m_head);
+                g_deallocate_array(allocator, m_usages);
+            }
+
+            s32 push(s32 next, FgUsage const& usage)
+            {
+                if (m_free < 0 && m_count == m_capacity)
+                {
+                    m_usages = s_grow_array(m_allocator, m_usages, m_count, 2 * m_capacity);
+                    m_capacity *= 2;
+                }
+                s32 const u = m_free >= 0 ? m_free : m_count++;
+                if (u == m_free)
+                    m_free = m_usages[u].m_next;
+                m_usages[u]        = usage;
+                m_usages[u].m_next = next;
+                return u;
+            }
+
+            void release(s32 u)
+            {
+                m_usages[u].m_next = m_free;
+                m_free             = u;
+            }
+        };
+
+        // Doubles the transitions of the graph, and 'source' (one per transition) from the compile allocator
+        static void s_grow_transitions(Fg* fg, alloc_t* allocator, s32*& source, s32 count)
+        {
+            s32 const capacity           = 2 * (s32)fg->m_transition_capacity + 16;
+            fg->m_transition_array       = s_grow_array(fg->m_allocator, fg->m_transition_array, count, capacity);
+            fg->m_transition_resource    = s_grow_array(fg->m_allocator, fg->m_transition_resource, count, capacity);
+            fg->m_transition_begin_array = s_grow_array(fg->m_allocator, fg->m_transition_begin_array, 0, capacity);
+            fg->m_transition_begin_index = s_grow_array(fg->m_allocator, fg->m_transition_begin_index, 0, capacity);
+            fg->m_transition_capacity    = (u32)capacity;
+            source                       = s_grow_array(allocator, source, count, capacity);
+        }
+
+        static void s_add_transitions(Fg* fg, alloc_t* allocator, FgRange const& range, FgIndex const* entries, FgFlags const* flags, FgSubresource const* subresources, FgIndex const* roots, FgUsageList& usage, bool read, u32 tag, s32 pass, s32*& source, s32& cursor)
+        {
+            for (s32 j = range.begin; j < range.end; ++j)
+            {
+                if (fg_flags_ignored(flags[j]))
+                    continue;
+
+                FgIndex const       root        = roots[entries[j]];
+                FgSubresource const subresource = subresources != nullptr ? subresources[j] : s_subresource_all;
+                if (usage.m_head[root] < 0)
+                    usage.m_head[root] = usage.push(-1, {s_flags_ignored, -1, false, s_subresource_all, -1});
+
+                // An access of the whole resource transitions every usage and replaces them with a single one
+                if (s_subresource_contains(subresource, s_subresource_all))
+                {
+                    s32 const first = usage.m_head[root];
+                    for (s32 u = first; u >= 0;)
+                    {
+                        FgUsage const last = usage.m_usages[u];
+                        if (!(read && last.m_read && last.m_flags.m_descr == flags[j].m_descr))
+                        {
+                            if (cursor == (s32)fg->m_transition_capacity)
+                                s_grow_transitions(fg, allocator, source, cursor);
+                            fg->m_transition_resource[cursor] = tag | root;
+                            fg->m_transition_array[cursor]    = {nullptr, nullptr, last.m_flags, flags[j], last.m_range};
+                            source[cursor]                    = fg_flags_ignored(last.m_flags) ? -1 : last.m_pass;
+                            cursor++;
+                        }
+                        if (u != first)
+                            usage.release(u);
+                        u = last.m_next;
+                    }
+                    usage.m_usages[first] = {flags[j], pass, read, subresource, -1};
+                    continue;
+                }
+
+                // Every usage that overlaps the access transitions in the overlapping part, which becomes part of the
+                // usage of this access. What remains of the usage is kept as up to four smaller usages.
+                for (s32* link = &usage.m_head[root]; *link >= 0;)
+                {
+                    s32 const     u    = *link;
+                    FgUsage const last = usage.m_usages[u];
+                    if (!s_subresource_overlaps(last.m_range, subresource))
+                    {
+                        link = &usage.m_usages[u].m_next;
+                        continue;
+                    }
+
+                    // A read following a read with the same usage does not change the state of the resource
+                    if (!(read && last.m_read && last.m_flags.m_descr == flags[j].m_descr))
+                    {
+                        if (cursor == (s32)fg->m_transition_capacity)
+                            s_grow_transitions(fg, allocator, source, cursor);
+                        fg->m_transition_resource[cursor] = tag | root;
+                        fg->m_transition_array[cursor]    = {nullptr, nullptr, last.m_flags, flags[j], s_subresource_intersect(last.m_range, subresource)};
+                        source[cursor]                    = fg_flags_ignored(last.m_flags) ? -1 : last.m_pass;
+                        cursor++;
+                    }
+
+                    FgSubresource remainder[4];
+                    s32 const     count = s_subresource_subtract(last.m_range, subresource, remainder);
+                    *link               = last.m_next;
+                    usage.release(u);
+                    for (s32 r = 0; r < count; ++r)
+                    {
+                        *link = usage.push(*link, {last.m_flags, last.m_pass, last.m_read, remainder[r], -1});
+                        link  = &usage.m_usages[*link].m_next;
+                    }
+                }
+                usage.m_head[root] = usage.push(usage.m_head[root], {flags[j], pass, read, subresource, -1});
+            }
+        }
+
+        // Per live pass the state transitions of the resources it reads and writes, the GfxTexture and GfxBuffer
+        // objects are filled in by s_resolve_transitions since they may differ per frame.
+        // A transition whose previous access is not in the live pass right before it is split, it begins
+        // after the pass of the previous access and ends before the pass, see FgPassInfo::m_transitions_end.
+        static void s_build_transitions(Fg* fg, alloc_t* allocator)
+        {
+            FgUsageList texture_usage;
+            FgUsageList buffer_usage;
+            texture_usage.setup(allocator, fg->m_textureinfo_cursor_main, fg->m_textureinfo_cursor[FgRead] + fg->m_textureinfo_cursor[FgWrite]);
+            buffer_usage.setup(allocator, fg->m_bufferinfo_cursor_main, fg->m_bufferinfo_cursor[FgRead] + fg->m_bufferinfo_cursor[FgWrite]);
+            s32* source = g_allocate_array<s32>(allocator, fg->m_transition_capacity);
+
+            // The root columns of the texture and buffer rows
+            FgIndex const* textures = fg->m_resources.m_root + fg->texture_row(0);
+            FgIndex const* buffers  = fg->m_resources.m_root + fg->buffer_row(0);
+
+            for (u32 i = 0; i < fg->m_pass_array_size; ++i)
+            {
+                fg->m_passinfo_array[i].m_transitions.reset(0);
+                fg->m_passinfo_array[i].m_transitions_begin.reset(0);
+            }
+
+            s32 cursor = 0;
+            for (s32 k = 0; k < fg->m_order_count; ++k)
+            {
+                s32 const   i    = fg->m_order[k];
+                FgPassInfo* pass = &fg->m_passinfo_array[i];
+                pass->m_transitions.reset(cursor);
+
+                s_add_transitions(fg, allocator, pass->m_texture[FgRead], fg->m_textureinfo_crw_array[FgRead], fg->m_textureinfo_crw_flags[FgRead], fg->m_textureinfo_crw_range[FgRead], textures, texture_usage, true, 0, i, source, cursor);
+                s_add_transitions(fg, allocator, pass->m_texture[FgWrite], fg->m_textureinfo_crw_array[FgWrite], fg->m_textureinfo_crw_flags[FgWrite], fg->m_textureinfo_crw_range[FgWrite], textures, texture_usage, false, 0, i, source, cursor);
+                s_add_transitions(fg, allocator, pass->m_buffer[FgRead], fg->m_bufferinfo_crw_array[FgRead], fg->m_bufferinfo_crw_flags[FgRead], nullptr, buffers, buffer_usage, true, c_transition_buffer, i, source, cursor);
+                s_add_transitions(fg, allocator, pass->m_buffer[FgWrite], fg->m_bufferinfo_crw_array[FgWrite], fg->m_bufferinfo_crw_flags[FgWrite], nullptr, buffers, buffer_usage, false, c_transition_buffer, i, source, cursor);
+                pass->m_transitions.end = cursor;
+            }
+
+            // Per pass, move the split transitions to the back of its range
+            for (u32 i = 0; i < fg->m_pass_array_size; ++i)
+            {
+                FgPassInfo* pass  = &fg->m_passinfo_array[i];
+                s32         split = pass->m_transitions.end;
+                for (s32 k = pass->m_transitions.begin; k < split;)
+                {
+                    if (source[k] < 0 || (pass->m_position - fg->m_passinfo_array[source[k]].m_position) <= 1)
+                    {
+                        ++k;
+                        continue;
+                    }
+                    --split;
+                    FgTransition const transition    = fg->m_transition_array[k];
+                    u32 const          resource      = fg->m_transition_resource[k];
+                    s32 const          from          = source[k];
+                    fg->m_transition_array[k]        = fg->m_transition_array[split];
+                    fg->m_transition_resource[k]     = fg->m_transition_resource[split];
+                    source[k]                        = source[split];
+                    fg->m_transition_array[split]    = transition;
+                    fg->m_transition_resource[split] = resource;
+                    source[split]                    = from;
+                }
+                pass->m_transitions_end.begin = split;
+                pass->m_transitions_end.end   = pass->m_transitions.end;
+                pass->m_transitions.end       = split;
+            }
+
+            // The begin lists, per pass the split transitions that begin after it (count, prefix-sum, fill)
+            for (u32 i = 0; i < fg->m_pass_array_size; ++i)
+            {
+                FgPassInfo const* pass = &fg->m_passinfo_array[i];
+                for (s32 k = pass->m_transitions_end.begin; k < pass->m_transitions_end.end; ++k)
+                    fg->m_passinfo_array[source[k]].m_transitions_begin.end++;
+            }
+            s32 begin_cursor = 0;
+            for (u32 i = 0; i < fg->m_pass_array_size; ++i)
+            {
+                FgRange&  range = fg->m_passinfo_array[i].m_transitions_begin;
+                s32 const size  = range.end;
+                range.begin     = begin_cursor;
+                range.end       = begin_cursor;
+                begin_cursor += size;
+            }
+            for (u32 i = 0; i < fg->m_pass_array_size; ++i)
+            {
+                FgPassInfo const* pass = &fg->m_passinfo_array[i];
+                for (s32 k = pass->m_transitions_end.begin; k < pass->m_transitions_end.end; ++k)
+                    fg->m_transition_begin_index[fg->m_passinfo_array[source[k]].m_transitions_begin.end++] = (u32)k;
+            }
+            fg->m_transition_count       = cursor;
+            fg->m_transition_begin_count = begin_cursor;
+
+            g_deallocate_array(allocator, source);
+            buffer_usage.teardown(allocator);
+            texture_usage.teardown(allocator);
+        }
+
+        // The physical GfxTexture and GfxBuffer objects of the transitions, they may differ per frame (and pooling)
+        static void s_resolve_transitions(Fg* fg)
+        {
+            for (s32 i = 0; i < fg->m_transition_count; ++i)
+            {
+                u32 const     resource   = fg->m_transition_resource[i];
+                FgTransition& transition = fg->m_transition_array[i];
+                if ((resource & c_transition_buffer) == c_transition_buffer)
+                    transition.m_buffer = fg->physical_buffer((FgIndex)(resource & ~c_transition_buffer));
+                else
+                    transition.m_texture = fg->physical_texture((FgIndex)resource);
+            }
+            for (s32 i = 0; i < fg->m_transition_begin_count; ++i)
+                fg->m_transition_begin_array[i] = fg->m_transition_array[fg->m_transition_begin_index[i]];
+        }
+
+        struct FgAliasItem
+        {
+            u64          m_size;
+            u64          m_alignment;
+            s32          m_first; // execution position of the pass that creates the resource
+            s32          m_last;  // execution position of the pass after which the resource is released
+            FgPlacement* m_placement;
+        };
+
+        static inline u64 s_align_up(u64 value, u64 alignment) { return (value + (alignment - 1)) / alignment * alignment; }
+
+        // The execution positions at which the (merged render pass of the) pass begins and ends, all transients of
+        // a merged render pass are alive for the whole render pass.
+        static inline s32 s_first_position(FgPassInfo const* pass) { return pass->m_subpass < 0 ? pass->m_position : pass->m_position - pass->m_subpass; }
+        static inline s32 s_last_position(FgPassInfo const* pass) { return pass->m_subpass < 0 ? pass->m_position : pass->m_position - pass->m_subpass + pass->m_subpass_count - 1; }
+
+        // Transient memory aliasing, greedy by size with a best-fit offset search. The largest resources
+        // are placed first, each one at the offset with the smallest gap between the resources already
+        // placed in the same heap that are alive at the same time.
+        static void s_plan_aliasing(Fg* fg, alloc_t* allocator)
+        {
+            for (s32 i = 0; i < fg->m_textureinfo_cursor_main; ++i)
+                fg->m_textureinfo_placement[i] = {-1, 0, 0};
+            for (s32 i = 0; i < fg->m_bufferinfo_cursor_main; ++i)
+                fg->m_bufferinfo_placement[i] = {-1, 0, 0};
+            fg->m_heap_count = 0;
+
+            s32 item_count = 0;
+            for (u32 i = 0; i < fg->m_pass_array_size; ++i)
+            {
+                FgPassInfo const* pass = &fg->m_passinfo_array[i];
+                item_count += fg->m_aliasing_texture ? pass->m_texture_release.size() : 0;
+                item_count += fg->m_aliasing_buffer ? pass->m_buffer_release.size() : 0;
+            }
+            if (item_count == 0)
+                return;
+
+            FgAliasItem*  items    = g_allocate_array_and_clear<FgAliasItem>(allocator, item_count);
+            FgAliasItem** overlaps = g_allocate_array_and_clear<FgAliasItem*>(allocator, item_count);
+
+            // Collect the physical transients together with their lifetime, in execution positions
+            s32 n = 0;
+            for (u32 i = 0; i < fg->m_pass_array_size; ++i)
+            {
+                FgPassInfo const* pass = &fg->m_passinfo_array[i];
+                for (s32 j = pass->m_texture_release.begin; j < pass->m_texture_release.end && fg->m_aliasing_texture; ++j)
+                {
+                    FgIndex const        index = fg->m_textureinfo_release_array[j];
+                    FgMemoryRequirements req   = {0, 1};
+                    fg->m_memory_texture.Call(fg->texture_descr(index), &req);
+                    items[n++] = {req.m_size, req.m_alignment == 0 ? 1 : req.m_alignment, s_first_position(fg->pass_at(fg->m_resources.m_pass[fg->texture_row(index)])), s_last_position(pass), &fg->m_textureinfo_placement[index]};
+                }
+                for (s32 j = pass->m_buffer_release.begin; j < pass->m_buffer_release.end && fg->m_aliasing_buffer; ++j)
+                {
+                    FgIndex const        index = fg->m_bufferinfo_release_array[j];
+                    FgMemoryRequirements req   = {0, 1};
+                    fg->m_memory_buffer.Call(fg->buffer_descr(index), &req);
+                    items[n++] = {req.m_size, req.m_alignment == 0 ? 1 : req.m_alignment, s_first_position(fg->pass_at(fg->m_resources.m_pass[fg->buffer_row(index)])), s_last_position(pass), &fg->m_bufferinfo_placement[index]};
+                }
+            }
+
+            // Largest first, ties in order of creation
+            for (s32 i = 1; i < item_count; ++i)
+            {
+                FgAliasItem const item = items[i];
+                s32               j    = i - 1;
+                for (; j >= 0 && (items[j].m_size < item.m_size || (items[j].m_size == item.m_size && items[j].m_first > item.m_first)); --j)
+                    items[j + 1] = items[j];
+                items[j + 1] = item;
+            }
+
+            for (s32 i = 0; i < item_count; ++i)
+            {
+                FgAliasItem& item = items[i];
+                for (s32 heap = 0;; ++heap)
+                {
+                    if (heap == fg->m_heap_count)
+                    {
+                        // Out of heaps, the resource is left unplaced and gets memory of its own
+                        if (fg->m_heap_count == c_max_heaps)
+                            break;
+                        fg->m_heap_size[fg->m_heap_count++] = 0;
+                    }
+
+                    // The placed resources in this heap that are alive at the same time, sorted by offset
+                    s32 overlap_count = 0;
+                    for (s32 j = 0; j < i; ++j)
+                    {
+                        FgAliasItem* other = &items[j];
+                        if (other->m_placement->m_heap == heap && other->m_first <= item.m_last && item.m_first <= other->m_last)
+                        {
+                            s32 k = overlap_count++;
+                            for (; k > 0 && overlaps[k - 1]->m_placement->m_offset > other->m_placement->m_offset; --k)
+                                overlaps[k] = overlaps[k - 1];
+                            overlaps[k] = other;
+                        }
+                    }
+
+                    // Best fit: the smallest gap that can hold the resource, else after the last one
+                    u64 best_offset = 0xFFFFFFFFFFFFFFFFull;
+                    u64 best_gap    = 0xFFFFFFFFFFFFFFFFull;
+                    u64 cursor      = 0;
+                    for (s32 j = 0; j < overlap_count; ++j)
+                    {
+                        FgPlacement const* other  = overlaps[j]->m_placement;
+                        u64 const          offset = s_align_up(cursor, item.m_alignment);
+                        if (other->m_offset >= offset + item.m_size && (other->m_offset - cursor) < best_gap)
+                        {
+                            best_gap    = other->m_offset - cursor;
+                            best_offset = offset;
+                        }
+                        if (other->m_offset + other->m_size > cursor)
+                            cursor = other->m_offset + other->m_size;
+                    }
+                    if (best_offset == 0xFFFFFFFFFFFFFFFFull)
+                        best_offset = s_align_up(cursor, item.m_alignment);
+
+                    // Does not fit in this heap, unless the heap is empty (resource larger than a heap)
+                    if (fg->m_heap_capacity != 0 && (best_offset + item.m_size) > fg->m_heap_capacity && fg->m_heap_size[heap] != 0)
+                        continue;
+
+                    item.m_placement->m_heap   = heap;
+                    item.m_placement->m_offset = best_offset;
+                    item.m_placement->m_size   = item.m_size;
+                    if ((best_offset + item.m_size) > fg->m_heap_size[heap])
+                        fg->m_heap_size[heap] = best_offset + item.m_size;
+                    break;
+                }
+            }
+
+            g_deallocate_array(allocator, overlaps);
+            g_deallocate_array(allocator, items);
+        }
+
+        struct FgAliasUser
+        {
+            s32 m_pass;
+            s32 m_next;
+        };
+
+        struct FgAliasedResource
+        {
+            s32                m_users; // the first entry of its list of users
+            s32                m_first; // execution position of its first user
+            s32                m_last;  // execution position of its last user
+            FgPlacement const* m_placement;
+        };
+
+        static inline bool s_memory_overlaps(FgPlacement const* a, FgPlacement const* b) { return a->m_heap == b->m_heap && a->m_offset < b->m_offset + b->m_size && b->m_offset < a->m_offset + a->m_size; }
+
+        // The order of the passes that use transients placed in the same memory, fg_execute follows it by executing the
+        // passes in order. For fg_execute_parallel every pass that uses a placed transient gets an edge from every pass that
+        // used an earlier transient sharing memory with it. The edges follow the execution order, so they add no cycles.
+        static void s_build_alias_edges(Fg* fg, alloc_t* allocator)
+        {
+            s32 const pass_count = (s32)fg->m_pass_array_size;
+            for (s32 i = 0; i < pass_count; ++i)
+            {
+                fg->m_passinfo_array[i].m_alias_successors.reset(0);
+                fg->m_passinfo_array[i].m_alias_dependencies = 0;
+            }
+            if (fg->m_heap_count == 0)
+                return;
+
+            // Per physical resource (textures, then buffers), the live passes that use it
+            s32 const texture_count  = fg->m_textureinfo_cursor_main;
+            s32 const resource_count = texture_count + fg->m_bufferinfo_cursor_main;
+            s32       user_count     = 0;
+            for (s32 i = 0; i < pass_count; ++i)
+            {
+                FgPassInfo const* pass = &fg->m_passinfo_array[i];
+                for (s32 c = FgCreate; c <= FgWrite && !s_is_culled(pass); ++c)
+                    user_count += pass->m_texture[c].size() + pass->m_buffer[c].size();
+            }
+
+            s32*         heads = g_allocate_array<s32>(allocator, resource_count);
+            FgAliasUser* users = g_allocate_array<FgAliasUser>(allocator, user_count);
+            for (s32 r = 0; r < resource_count; ++r)
+                heads[r] = -1;
+            s32 n = 0;
+            for (s32 i = 0; i < pass_count; ++i)
+            {
+                FgPassInfo const* pass = &fg->m_passinfo_array[i];
+                if (s_is_culled(pass))
+                    continue;
+                for (s32 c = FgCreate; c <= FgWrite; ++c)
+                {
+                    for (s32 j = pass->m_texture[c].begin; j < pass->m_texture[c].end; ++j)
+                    {
+                        s32 const r = fg->m_resources.m_root[fg->texture_row(fg->m_textureinfo_crw_array[c][j])];
+                        if (heads[r] < 0 || users[heads[r]].m_pass != i)
+                        {
+                            users[n] = {i, heads[r]};
+                            heads[r] = n++;
+                        }
+                    }
+                    for (s32 j = pass->m_buffer[c].begin; j < pass->m_buffer[c].end; ++j)
+                    {
+                        s32 const r = texture_count + fg->m_resources.m_root[fg->buffer_row(fg->m_bufferinfo_crw_array[c][j])];
+                        if (heads[r] < 0 || users[heads[r]].m_pass != i)
+                        {
+                            users[n] = {i, heads[r]};
+                            heads[r] = n++;
+                        }
+                    }
+                }
+            }
+
+            // The placed transients with the execution positions of their users
+            FgAliasedResource* placed       = g_allocate_array<FgAliasedResource>(allocator, resource_count);
+            s32                placed_count = 0;
+            for (s32 r = 0; r < resource_count; ++r)
+            {
+                bool const         buffer    = r >= texture_count;
+                FgPlacement const* placement = buffer ? &fg->m_bufferinfo_placement[r - texture_count] : &fg->m_textureinfo_placement[r];
+                if (!(buffer ? fg->m_aliasing_buffer : fg->m_aliasing_texture) || placement->m_heap < 0 || heads[r] < 0)
+                    continue;
+                FgAliasedResource& item = placed[placed_count++];
+                item                    = {heads[r], 0x7FFFFFFF, -1, placement};
+                for (s32 u = heads[r]; u >= 0; u = users[u].m_next)
+                {
+                    FgPassInfo const* pass  = &fg->m_passinfo_array[users[u].m_pass];
+                    s32 const         first = s_first_position(pass);
+                    s32 const         last  = s_last_position(pass);
+                    item.m_first            = first < item.m_first ? first : item.m_first;
+                    item.m_last             = last > item.m_last ? last : item.m_last;
+                }
+            }
+
+            // Count the edges per pass, then fill them in
+            s32 edge_count = 0;
+            for (s32 fill = 0; fill < 2; ++fill)
+            {
+                for (s32 a = 0; a < placed_count; ++a)
+                {
+                    for (s32 b = 0; b < placed_count; ++b)
+                    {
+                        if (placed[a].m_last >= placed[b].m_first || !s_memory_overlaps(placed[a].m_placement, placed[b].m_placement))
+                            continue;
+                        for (s32 u = placed[a].m_users; u >= 0; u = users[u].m_next)
+                        {
+                            FgPassInfo* from = &fg->m_passinfo_array[users[u].m_pass];
+                            for (s32 v = placed[b].m_users; v >= 0; v = users[v].m_next)
+                            {
+                                if (fill == 0)
+                                {
+                                    from->m_alias_successors.end++;
+                                    fg->m_passinfo_array[users[v].m_pass].m_alias_dependencies++;
+                                    edge_count++;
+                                }
+                                else
+                                {
+                                    fg->m_alias_edge_array[from->m_alias_successors.end++] = (FgIndex)users[v].m_pass;
+                                }
+                            }
+                        }
+                    }
+                }
+                if (fill == 1)
+                    break;
+
+                if (edge_count > (s32)fg->m_alias_edge_capacity)
+                {
+                    fg->m_alias_edge_capacity = (u32)edge_count * 2;
+                    g_deallocate_array(fg->m_allocator, fg->m_alias_edge_array);
+                    fg->m_alias_edge_array = g_allocate_array<FgIndex>(fg->m_allocator, fg->m_alias_edge_capacity);
+                }
+                s32 begin = 0;
+                for (s32 i = 0; i < pass_count; ++i)
+                {
+                    FgRange&  range = fg->m_passinfo_array[i].m_alias_successors;
+                    s32 const count = range.size();
+                    range.reset(begin);
+                    begin += count;
+                }
+            }
+
+            g_deallocate_array(allocator, placed);
+            g_deallocate_array(allocator, users);
+            g_deallocate_array(allocator, heads);
+        }
+
+        // Hash of the memory requirements of the physical transients, when it did not change the aliasing plan and the
+        // memory-aware schedule are still valid
+        static u64 s_hash_memory(Fg* fg)
+        {
+            u64 hash = s_hash_mix(s_hash_mix(c_hash_seed, fg->m_heap_capacity), (fg->m_aliasing_texture ? 1 : 0) | (fg->m_aliasing_buffer ? 2 : 0) | (fg->m_memory_schedule ? 4 : 0));
+
+            bool const textures = fg->m_aliasing_texture || fg->m_memory_schedule;
+            bool const buffers  = fg->m_aliasing_buffer || fg->m_memory_schedule;
+            for (u32 i = 0; i < fg->m_pass_array_size; ++i)
+            {
+                FgPassInfo const* pass = &fg->m_passinfo_array[i];
+                for (s32 j = pass->m_texture_release.begin; j < pass->m_texture_release.end && textures; ++j)
+                {
+                    FgMemoryRequirements req = {0, 1};
+                    fg->m_memory_texture.Call(fg->texture_descr(fg->m_textureinfo_release_array[j]), &req);
+                    hash = s_hash_mix(s_hash_mix(hash, req.m_size), req.m_alignment);
+                }
+                for (s32 j = pass->m_buffer_release.begin; j < pass->m_buffer_release.end && buffers; ++j)
+                {
+                    FgMemoryRequirements req = {0, 1};
+                    fg->m_memory_buffer.Call(fg->buffer_descr(fg->m_bufferinfo_release_array[j]), &req);
+                    hash = s_hash_mix(s_hash_mix(hash, req.m_size), req.m_alignment);
+                }
+            }
+            return hash;
+        }
+
+        // A graphics queue pass that only writes textures, and all of them as attachments
+        static bool s_is_raster_pass(Fg* fg, FgPassInfo const* pass)
+        {
+            if (pass->m_queue != FgQueueGraphics || pass->m_texture[FgWrite].size() == 0 || pass->m_buffer[FgWrite].size() > 0)
+                return false;
+            for (s32 j = pass->m_texture[FgWrite].begin; j < pass->m_texture[FgWrite].end; ++j)
+            {
+                FgFlags const flags = fg->m_textureinfo_crw_flags[FgWrite][j];
+                if (fg_flags_ignored(flags) || fg->m_classify_attachment.Call(flags) != FgAttachmentWrite)
+                    return false;
+            }
+            return true;
+        }
+
+        // The transitions of the subpasses after the first one follow each other in the transition array (a subpass has no
+        // split transitions), the subpass dependencies among them are moved to the back. The others stay with their pass.
+        static void s_move_subpass_dependencies(Fg* fg, alloc_t* allocator, FgPass const* passes, s32 count, u8 const* dependency)
+        {
+            s32 const     begin     = passes[1]->m_transitions.begin;
+            s32 const     end       = passes[count - 1]->m_transitions.end;
+            FgTransition* moved     = g_allocate_array<FgTransition>(allocator, end - begin);
+            u32*          resources = g_allocate_array<u32>(allocator, end - begin);
+
+            s32 n = 0;
+            for (s32 t = begin; t < end; ++t)
+            {
+                if (dependency[t] == 0)
+                    continue;
+                moved[n]     = fg->m_transition_array[t];
+                resources[n] = fg->m_transition_resource[t];
+                n++;
+            }
+
+            s32 cursor = begin;
+            for (s32 g = 1; g < count; ++g)
+            {
+                FgPassInfo* pass  = passes[g];
+                s32 const   first = cursor;
+                for (s32 t = pass->m_transitions.begin; t < pass->m_transitions.end; ++t)
+                {
+                    if (dependency[t] != 0)
+                        continue;
+                    fg->m_transition_array[cursor]    = fg->m_transition_array[t];
+                    fg->m_transition_resource[cursor] = fg->m_transition_resource[t];
+                    cursor++;
+                }
+                pass->m_transitions.begin = first;
+                pass->m_transitions.end   = cursor;
+                pass->m_transitions_end.reset(cursor);
+            }
+
+            passes[0]->m_subpass_dependencies.begin = cursor;
+            passes[0]->m_subpass_dependencies.end   = end;
+            for (s32 i = 0; i < n; ++i)
+            {
+                fg->m_transition_array[cursor + i]    = moved[i];
+                fg->m_transition_resource[cursor + i] = resources[i];
+            }
+
+            g_deallocate_array(allocator, resources);
+            g_deallocate_array(allocator, moved);
+        }
+
+        // Can the raster pass become the next subpass of the render pass that wrote the textures marked with 'group', after
+        // the pass 'previous'. It only reads the textures written in the render pass as input attachments. Queue operations
+        // and split transitions can not be issued inside a render pass, and its other transitions are issued before the
+        // render pass begins, so they may not be on a resource that was used earlier in the render pass.
+        static bool s_is_subpass(Fg* fg, FgPassInfo const* pass, FgPassInfo const* previous, s32 const* written, s32 const* accessed, s32 group)
+        {
+            if (pass->m_waits.size() > 0 || pass->m_transitions_end.size() > 0 || previous->m_transitions_begin.size() > 0 || previous->m_signal)
+                return false;
+
+            for (s32 j = pass->m_texture[FgRead].begin; j < pass->m_texture[FgRead].end; ++j)
+            {
+                FgIndex const root = fg->m_resources.m_root[fg->texture_row(fg->m_textureinfo_crw_array[FgRead][j])];
+                if (written[root] != group)
+                    continue;
+
+                // Ignored flags are the read of an attachment that the pass continues to write (fg_write)
+                FgFlags const flags = fg->m_textureinfo_crw_flags[FgRead][j];
+                if (!fg_flags_ignored(flags) && fg->m_classify_attachment.Call(flags) != FgAttachmentInput)
+                    return false;
+            }
+
+            for (s32 k = pass->m_transitions.begin; k < pass->m_transitions.end; ++k)
+            {
+                u32 const resource = fg->m_transition_resource[k];
+                if ((resource & c_transition_buffer) == c_transition_buffer)
+                {
+                    if (accessed[fg->m_textureinfo_cursor_main + (resource & ~c_transition_buffer)] == group)
+                        return false;
+                }
+                else if (written[resource] != group && accessed[resource] == group)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Consecutive raster passes (in execution order) are merged into one render pass as long as every pass only
+        // reads what was written earlier in the render pass through input attachments. The transitions of the textures
+        // written earlier in the render pass are its subpass dependencies, they are moved to the back of the transitions
+        // of its subpasses (see FgPassInfo::m_subpass_dependencies).
+        static void s_build_render_passes(Fg* fg, alloc_t* allocator)
+        {
+            for (u32 i = 0; i < fg->m_pass_array_size; ++i)
+            {
+                fg->m_passinfo_array[i].m_subpass       = -1;
+                fg->m_passinfo_array[i].m_subpass_count = 0;
+                fg->m_passinfo_array[i].m_subpass_dependencies.reset(0);
+            }
+            if (!fg->m_merge_render_passes || fg->m_textureinfo_cursor_main == 0)
+                return;
+
+            // Per physical texture, the first position of the render pass that wrote it. Per physical texture and buffer,
+            // the first position of the render pass that used it. Per transition, is it a subpass dependency.
+            s32 const resource_count = fg->m_textureinfo_cursor_main + fg->m_bufferinfo_cursor_main;
+            s32*      written        = g_allocate_array<s32>(allocator, fg->m_textureinfo_cursor_main);
+            s32*      accessed       = g_allocate_array<s32>(allocator, resource_count);
+            u8*       dependency     = g_allocate_array_and_clear<u8>(allocator, fg->m_transition_count);
+            for (s32 i = 0; i < fg->m_textureinfo_cursor_main; ++i)
+                written[i] = -1;
+            for (s32 i = 0; i < resource_count; ++i)
+                accessed[i] = -1;
+
+            s32 group = -1;
+            for (s32 k = 0; k <= fg->m_order_count; ++k)
+            {
+                FgPassInfo* pass    = k < fg->m_order_count ? fg->m_order_pass[k] : nullptr;
+                bool const  raster  = pass != nullptr && s_is_raster_pass(fg, pass);
+                bool const  subpass = group >= 0 && raster && s_is_subpass(fg, pass, fg->m_order_pass[k - 1], written, accessed, group);
+                if (group >= 0 && !subpass)
+                {
+                    // Close the render pass, a single pass is not a merged render pass
+                    s32 const count = k - group;
+                    for (s32 g = group; g < k && count > 1; ++g)
+                    {
+                        fg->m_order_pass[g]->m_subpass       = g - group;
+                        fg->m_order_pass[g]->m_subpass_count = count;
+                    }
+                    if (count > 1)
+                        s_move_subpass_dependencies(fg, allocator, &fg->m_order_pass[group], count, dependency);
+                    group = -1;
+                }
+                if (!raster)
+                    continue;
+
+                if (group < 0)
+                    group = k;
+                for (s32 t = pass->m_transitions.begin; t < pass->m_transitions.end && subpass; ++t)
+                {
+                    u32 const resource = fg->m_transition_resource[t];
+                    dependency[t]      = ((resource & c_transition_buffer) == 0 && written[resource] == group) ? 1 : 0;
+                }
+                for (s32 c = FgRead; c <= FgWrite; ++c)
+                {
+                    for (s32 j = pass->m_texture[c].begin; j < pass->m_texture[c].end; ++j)
+                        accessed[fg->m_resources.m_root[fg->texture_row(fg->m_textureinfo_crw_array[c][j])]] = group;
+                    for (s32 j = pass->m_buffer[c].begin; j < pass->m_buffer[c].end; ++j)
+                        accessed[fg->m_textureinfo_cursor_main + fg->m_resources.m_root[fg->buffer_row(fg->m_bufferinfo_crw_array[c][j])]] = group;
+                }
+                for (s32 j = pass->m_texture[FgWrite].begin; j < pass->m_texture[FgWrite].end; ++j)
+                    written[fg->m_resources.m_root[fg->texture_row(fg->m_textureinfo_crw_array[FgWrite][j])]] = group;
+            }
+
+            g_deallocate_array(allocator, dependency);
+            g_deallocate_array(allocator, accessed);
+            g_deallocate_array(allocator, written);
+        }
+
+        // A written version has nothing to load when the pass created it or clears it, it has to be stored when a pass after
+        // the (merged render) pass reads it, or when it leaves the frame (not transient, or written by a final pass).
+        static void s_build_attachment_ops(Fg* fg)
+        {
+            for (s32 k = 0; k < fg->m_order_count; ++k)
+            {
+                FgPassInfo const* pass = fg->m_order_pass[k];
+                s32 const         last = s_last_position(pass);
+                for (s32 j = pass->m_texture[FgWrite].begin; j < pass->m_texture[FgWrite].end; ++j)
+                {
+                    FgIndex const    index = fg->m_textureinfo_crw_array[FgWrite][j];
+                    u32 const        row   = fg->texture_row(index);
+                    u16 const        flags = fg->m_resources.m_flags[row];
+                    FgAttachmentOps& ops   = fg->m_textureinfo_ops[index];
+
+                    if ((flags & CLEAR) == CLEAR)
+                        ops.m_load = FgLoadOpClear;
+                    else if (fg->m_resources.m_root[row] == index && (flags & IMPORTED) == 0)
+                        ops.m_load = FgLoadOpDontCare;
+                    else
+                        ops.m_load = FgLoadOpLoad;
+
+                    bool const leaves_frame = (flags & TRANSIENT) == 0 || pass->m_final != 0;
+                    ops.m_store             = (leaves_frame || fg->pass_at(fg->m_resources.m_last[row])->m_position > last) ? FgStoreOpStore : FgStoreOpDontCare;
+                }
+            }
+        }
+
+        // Memory-aware scheduling, a list scheduler that picks from the passes whose dependencies have all been
+        // scheduled the one that adds the least to the live transient memory, the memory of the transients it
+        // creates minus the memory of the transients it is the last user of. Ties keep the declaration order.
+        struct FgScheduler
+        {
+            FgRange* m_roots;      // per pass, the begin and end index into 'm_root_array'
+            s32*     m_root_array; // per pass, the physical resources it uses (textures, then buffers)
+            u64*     m_size;       // per physical resource, its memory size when it is a transient
+            u64*     m_created;    // per pass, the memory of the transients it creates
+            s32*     m_users;      // per physical resource, the number of live passes that use it
+            s32*     m_remaining;  // per physical resource, the number of live passes that use it and did not run yet
+            s32*     m_stamp;      // per physical resource, the pass that added it last
+            s32      m_count;      // the number of physical resources
+
+            void add(FgRange const& range, FgIndex const* entries, FgIndex const* roots, s32 offset, s32 pass, bool created, s32& cursor)
+            {
+                for (s32 j = range.begin; j < range.end; ++j)
+                {
+                    s32 const root = offset + roots[entries[j]];
+                    if (created)
+                        m_created[pass] += m_size[root];
+                    if (m_stamp[root] == pass)
+                        continue;
+                    m_stamp[root]          = pass;
+                    m_root_array[cursor++] = root;
+                    m_users[root]++;
+                }
+            }
+
+            s64 delta(s32 pass) const
+            {
+                s64 delta = (s64)m_created[pass];
+                for (s32 j = m_roots[pass].begin; j < m_roots[pass].end; ++j)
+                {
+                    if (m_remaining[m_root_array[j]] == 1)
+                        delta -= (s64)m_size[m_root_array[j]];
+                }
+                return delta;
+            }
+
+            void retire(s32 pass)
+            {
+                for (s32 j = m_roots[pass].begin; j < m_roots[pass].end; ++j)
+                    m_remaining[m_root_array[j]]--;
+            }
+
+            u64 peak(FgIndex const* order, s32 count)
+            {
+                for (s32 i = 0; i < m_count; ++i)
+                    m_remaining[i] = m_users[i];
+
+                u64 live = 0;
+                u64 peak = 0;
+                for (s32 k = 0; k < count; ++k)
+                {
+                    s32 const pass = order[k];
+                    live += m_created[pass];
+                    if (live > peak)
+                        peak = live;
+                    for (s32 j = m_roots[pass].begin; j < m_roots[pass].end; ++j)
+                    {
+                        if (--m_remaining[m_root_array[j]] == 0)
+                            live -= m_size[m_root_array[j]];
+                    }
+                }
+
+                for (s32 i = 0; i < m_count; ++i)
+                    m_remaining[i] = m_users[i];
+                return peak;
+            }
+        };
+
+        static void s_build_schedule(Fg* fg, alloc_t* allocator)
+        {
+            // Declaration order
+            fg->m_order_count = 0;
+            for (u32 i = 0; i < fg->m_pass_array_size; ++i)
+            {
+                fg->m_passinfo_array[i].m_position = -1;
+                if (!s_is_culled(&fg->m_passinfo_array[i]))
+                    fg->m_order[fg->m_order_count++] = (FgIndex)i;
+            }
+            fg->m_peak_declared  = 0;
+            fg->m_peak_scheduled = 0;
+
+            if (fg->m_memory_schedule && fg->m_order_count > 1)
+            {
+                s32 const texture_count = fg->m_textureinfo_cursor_main;
+                s32 const entry_count   = fg->m_textureinfo_cursor[FgCreate] + fg->m_textureinfo_cursor[FgRead] + fg->m_textureinfo_cursor[FgWrite] + fg->m_bufferinfo_cursor[FgCreate] + fg->m_bufferinfo_cursor[FgRead] + fg->m_bufferinfo_cursor[FgWrite];
+
+                FgScheduler scheduler;
+                scheduler.m_count      = texture_count + fg->m_bufferinfo_cursor_main;
+                scheduler.m_roots      = g_allocate_array_and_clear<FgRange>(allocator, fg->m_pass_array_size);
+                scheduler.m_root_array = g_allocate_array<s32>(allocator, entry_count);
+                scheduler.m_size       = g_allocate_array_and_clear<u64>(allocator, scheduler.m_count);
+                scheduler.m_created    = g_allocate_array_and_clear<u64>(allocator, fg->m_pass_array_size);
+                scheduler.m_users      = g_allocate_array_and_clear<s32>(allocator, scheduler.m_count);
+                scheduler.m_remaining  = g_allocate_array_and_clear<s32>(allocator, scheduler.m_count);
+                scheduler.m_stamp      = g_allocate_array<s32>(allocator, scheduler.m_count);
+                for (s32 i = 0; i < scheduler.m_count; ++i)
+                    scheduler.m_stamp[i] = -1;
+
+                // The memory of the physical transients
+                FgResourceTable const& table = fg->m_resources;
+                for (s32 i = 0; i < texture_count; ++i)
+                {
+                    u32 const            row = fg->texture_row((FgIndex)i);
+                    FgMemoryRequirements req = {0, 1};
+                    if (table.m_root[row] == i && (table.m_flags[row] & TRANSIENT) == TRANSIENT)
+                        fg->m_memory_texture.Call(fg->texture_descr((FgIndex)i), &req);
+                    scheduler.m_size[i] = req.m_size;
+                }
+                for (s32 i = 0; i < fg->m_bufferinfo_cursor_main; ++i)
+                {
+                    u32 const            row = fg->buffer_row((FgIndex)i);
+                    FgMemoryRequirements req = {0, 1};
+                    if (table.m_root[row] == i && (table.m_flags[row] & TRANSIENT) == TRANSIENT)
+                        fg->m_memory_buffer.Call(fg->buffer_descr((FgIndex)i), &req);
+                    scheduler.m_size[texture_count + i] = req.m_size;
+                }
+
+                // Per live pass the physical resources it uses, a resource used on another queue than the graphics
+                // queue is kept alive until the end of the frame (see s_build_release_lists).
+                FgIndex const* textures = table.m_root + fg->texture_row(0);
+                FgIndex const* buffers  = table.m_root + fg->buffer_row(0);
+                s32            cursor   = 0;
+                for (s32 k = 0; k < fg->m_order_count; ++k)
+                {
+                    s32 const         i    = fg->m_order[k];
+                    FgPassInfo const* pass = &fg->m_passinfo_array[i];
+                    scheduler.m_roots[i].reset(cursor);
+                    for (s32 t = FgCreate; t <= FgWrite; ++t)
+                    {
+                        scheduler.add(pass->m_texture[t], fg->m_textureinfo_crw_array[t], textures, 0, i, t == FgCreate, cursor);
+                        scheduler.add(pass->m_buffer[t], fg->m_bufferinfo_crw_array[t], buffers, texture_count, i, t == FgCreate, cursor);
+                    }
+                    scheduler.m_roots[i].end = cursor;
+                    if (pass->m_queue != FgQueueGraphics)
+                    {
+                        for (s32 j = scheduler.m_roots[i].begin; j < scheduler.m_roots[i].end; ++j)
+                            scheduler.m_users[scheduler.m_root_array[j]] += 1 << 16;
+                    }
+                }
+
+                fg->m_peak_declared = scheduler.peak(fg->m_order, fg->m_order_count);
+
+                // List scheduling, the parallel execution arrays are used as scratch
+                s32* pending     = fg->m_pass_pending;
+                s32* ready       = fg->m_ready_array;
+                s32  ready_count = 0;
+                for (s32 k = 0; k < fg->m_order_count; ++k)
+                {
+                    s32 const i = fg->m_order[k];
+                    pending[i]  = fg->m_passinfo_array[i].m_dependencies;
+                    if (pending[i] == 0)
+                        ready[ready_count++] = i;
+                }
+                for (s32 k = 0; k < fg->m_order_count; ++k)
+                {
+                    s32 best = 0;
+                    s64 cost = scheduler.delta(ready[0]);
+                    for (s32 r = 1; r < ready_count; ++r)
+                    {
+                        s64 const c = scheduler.delta(ready[r]);
+                        if (c < cost || (c == cost && ready[r] < ready[best]))
+                        {
+                            best = r;
+                            cost = c;
+                        }
+                    }
+
+                    s32 const i    = ready[best];
+                    ready[best]    = ready[--ready_count];
+                    fg->m_order[k] = (FgIndex)i;
+                    scheduler.retire(i);
+
+                    FgPassInfo const* pass = &fg->m_passinfo_array[i];
+                    for (s32 j = pass->m_successors.begin; j < pass->m_successors.end; ++j)
+                    {
+                        FgIndex const successor = fg->m_edge_array[j];
+                        if (--pending[successor] == 0)
+                            ready[ready_count++] = successor;
+                    }
+                }
+
+                fg->m_peak_scheduled = scheduler.peak(fg->m_order, fg->m_order_count);
+
+                g_deallocate_array(allocator, scheduler.m_stamp);
+                g_deallocate_array(allocator, scheduler.m_remaining);
+                g_deallocate_array(allocator, scheduler.m_users);
+                g_deallocate_array(allocator, scheduler.m_created);
+                g_deallocate_array(allocator, scheduler.m_size);
+                g_deallocate_array(allocator, scheduler.m_root_array);
+                g_deallocate_array(allocator, scheduler.m_roots);
+            }
+
+            for (s32 k = 0; k < fg->m_order_count; ++k)
+            {
+                fg->m_order_pass[k]             = &fg->m_passinfo_array[fg->m_order[k]];
+                fg->m_order_pass[k]->m_position = k;
+            }
+        }
+
+        // The number of versions produced (created or written) by each pass
+        static void s_count_produced(Fg* fg, u32 row, u32 count)
+        {
+            FgIndex const* pass = fg->m_resources.m_pass;
+            for (u32 i = row; i < row + count; ++i)
+            {
+                if (pass[i] != c_no_pass)
+                    fg->m_passinfo_array[pass[i]].m_ref_count++;
+            }
+        }
+
+        // Culling with ref-counts. A version is referenced by the passes that read it (and once more when a final pass
+        // writes it), a pass by the versions it produces. A version without references releases its producer, a
+        // producer without references releases the versions it reads.
+        static void s_cull_ref_count(Fg* fg, alloc_t* allocator)
+        {
+            FgResourceTable& table = fg->m_resources;
+
+            for (u32 i = 0; i < fg->m_pass_array_size; ++i)
+            {
+                FgPassInfo* pass  = &fg->m_passinfo_array[i];
+                pass->m_ref_count = 0;
+
+                // Texture and Buffer read
+                for (s32 j = pass->m_texture[FgRead].begin; j < pass->m_texture[FgRead].end; ++j)
+                    table.m_ref_count[fg->texture_row(fg->m_textureinfo_crw_array[FgRead][j])]++;
+                for (s32 j = pass->m_buffer[FgRead].begin; j < pass->m_buffer[FgRead].end; ++j)
+                    table.m_ref_count[fg->buffer_row(fg->m_bufferinfo_crw_array[FgRead][j])]++;
+
+                // Texture and Buffer written by a final pass
+                for (s32 j = pass->m_texture[FgWrite].begin; j < pass->m_texture[FgWrite].end; ++j)
+                    table.m_ref_count[fg->texture_row(fg->m_textureinfo_crw_array[FgWrite][j])] += (pass->m_final == 1) ? 1 : 0;
+                for (s32 j = pass->m_buffer[FgWrite].begin; j < pass->m_buffer[FgWrite].end; ++j)
+                    table.m_ref_count[fg->buffer_row(fg->m_bufferinfo_crw_array[FgWrite][j])] += (pass->m_final == 1) ? 1 : 0;
+            }
+            s_count_produced(fg, fg->texture_row(0), fg->m_textureinfo_cursor_main);
+            s_count_produced(fg, fg->buffer_row(0), fg->m_bufferinfo_cursor_main);
+
+            // A stack of rows of the resource table
+            s32 const max_stack_size = fg->m_textureinfo_cursor_main + fg->m_bufferinfo_cursor_main;
+            u32*      stack          = g_allocate_array<u32>(allocator, max_stack_size);
+            s32       stack_size     = 0;
+            for (u32 row = fg->texture_row(0); row < fg->texture_row(fg->m_textureinfo_cursor_main); ++row)
+            {
+                if (table.m_ref_count[row] == 0)
+                    stack[stack_size++] = row;
+            }
+            for (u32 row = fg->buffer_row(0); row < fg->buffer_row(fg->m_bufferinfo_cursor_main); ++row)
+            {
+                if (table.m_ref_count[row] == 0)
+                    stack[stack_size++] = row;
+            }
+
+            while (stack_size > 0)
+            {
+                u32 const   row      = stack[--stack_size];
+                FgPassInfo* producer = fg->pass_at(table.m_pass[row]);
+                if (producer == nullptr || ((producer->m_flags & HAS_SIDE_EFFECTS) == HAS_SIDE_EFFECTS))
+                    continue;
+
+                ASSERT(producer->m_ref_count >= 1);
+                if (--producer->m_ref_count == 0 && producer->m_final == 0)
+                {
+                    for (s32 j = producer->m_texture[FgRead].begin; j < producer->m_texture[FgRead].end; ++j)
+                    {
+                        u32 const consumed = fg->texture_row(fg->m_textureinfo_crw_array[FgRead][j]);
+                        if (--table.m_ref_count[consumed] == 0)
+                            stack[stack_size++] = consumed;
+                    }
+                    for (s32 j = producer->m_buffer[FgRead].begin; j < producer->m_buffer[FgRead].end; ++j)
+                    {
+                        u32 const consumed = fg->buffer_row(fg->m_bufferinfo_crw_array[FgRead][j]);
+                        if (--table.m_ref_count[consumed] == 0)
+                            stack[stack_size++] = consumed;
+                    }
+                }
+            }
+            g_deallocate_array(allocator, stack);
+        }
+
+        // Sparse bitsets, only the words that have a bit set are stored (a word can repeat), word 'k' is 'm_bits[k]' at
+        // index 'm_word[k]'
+        struct FgSparseBits
+        {
+            s32* m_word;
+            u64* m_bits;
+        };
+
+        // Appends the bits of the entries to the mask, consecutive entries in the same word share it. Branch free, the
+        // entries of a pass jump between words in no particular order.
+        static s32 s_bits_append(FgSparseBits& mask, s32 count, FgRange const& range, FgIndex const* entries, s32 offset)
+        {
+            if (range.begin == range.end)
+                return count;
+
+            // The last word of the mask is accumulated in 'bits', the entries can continue it
+            s32 word = -1;
+            u64 bits = 0;
+            if (--count >= 0)
+            {
+                word = mask.m_word[count];
+                bits = mask.m_bits[count];
+            }
+            for (s32 j = range.begin; j < range.end; ++j)
+            {
+                s32 const bit  = offset + entries[j];
+                s32 const next = bit >> 6;
+                s32 const step = next != word ? 1 : 0;
+                count += step;
+                bits               = (step != 0 ? 0 : bits) | (1ull << (bit & 63));
+                word               = next;
+                mask.m_word[count] = word;
+                mask.m_bits[count] = bits;
+            }
+            return count + 1;
+        }
+
+        // Does any word of the mask have a bit in common with 'live'
+        static bool s_bits_intersect(u64 const* live, FgSparseBits const& mask, s32 count)
+        {
+            s32 k = 0;
+#if defined(FG_BITS_AVX2)
+            for (; k + 4 <= count; k += 4)
+            {
+                __m256i const words = _mm256_i32gather_epi64((long long const*)live, _mm_loadu_si128((__m128i const*)(mask.m_word + k)), 8);
+                __m256i const x     = _mm256_and_si256(words, _mm256_loadu_si256((__m256i const*)(mask.m_bits + k)));
+                if (!_mm256_testz_si256(x, x))
+                    return true;
+            }
+#elif defined(FG_BITS_SSE2)
+            for (; k + 2 <= count; k += 2)
+            {
+                __m128i const words = _mm_set_epi64x((long long)live[mask.m_word[k + 1]], (long long)live[mask.m_word[k]]);
+                __m128i const x     = _mm_and_si128(words, _mm_loadu_si128((__m128i const*)(mask.m_bits + k)));
+                if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_setzero_si128())) != 0xFFFF)
+                    return true;
+            }
+#endif
+            for (; k < count; ++k)
+            {
+                if ((live[mask.m_word[k]] & mask.m_bits[k]) != 0)
+                    return true;
+            }
+            return false;
+        }
+
+        // live |= mask
+        static void s_bits_or(u64* live, FgSparseBits const& mask, s32 count)
+        {
+            for (s32 k = 0; k < count; ++k)
+                live[mask.m_word[k]] |= mask.m_bits[k];
+        }
+
+        // Culling on bitsets, bit 'i' is texture version 'i' and bit 'texture_count + i' is buffer version 'i'. Every pass
+        // has a read mask and a produce mask (the versions it creates or writes), sparse so that a pass costs its entries
+        // and not the number of versions. A version is only read by passes that are declared after its producer, so one
+        // sweep in reverse declaration order decides every pass: a pass is used when its produce mask intersects the live
+        // bits, the read masks of the passes that are kept are or-ed into them. The result is the same as s_cull_ref_count,
+        // also for a pass that produces nothing, it is culled but keeps what it reads alive.
+        // A mask is used once, so it is built when the sweep reaches the pass, in a buffer that stays in the cache.
+        static void s_cull_bitset(Fg* fg, alloc_t* allocator)
+        {
+            s32 const texture_count = fg->m_textureinfo_cursor_main;
+            s32 const bit_count     = texture_count + fg->m_bufferinfo_cursor_main;
+            s32 const pass_count    = (s32)fg->m_pass_array_size;
+
+            // A mask has at most a word per entry
+            s32 entry_count = 0;
+            for (s32 i = 0; i < pass_count; ++i)
+            {
+                FgPassInfo const* pass     = &fg->m_passinfo_array[i];
+                s32 const         reads    = pass->m_texture[FgRead].size() + pass->m_buffer[FgRead].size();
+                s32 const         produces = pass->m_texture[FgCreate].size() + pass->m_texture[FgWrite].size() + pass->m_buffer[FgCreate].size() + pass->m_buffer[FgWrite].size();
+                entry_count                = reads > entry_count ? reads : entry_count;
+                entry_count                = produces > entry_count ? produces : entry_count;
+            }
+
+            FgSparseBits mask;
+            mask.m_word = g_allocate_array<s32>(allocator, entry_count + 1);
+            mask.m_bits = g_allocate_array<u64>(allocator, entry_count + 1);
+            u64* live   = g_allocate_array_and_clear<u64>(allocator, ((bit_count + 63) >> 6) + 1);
+            for (s32 i = pass_count - 1; i >= 0; --i)
+            {
+                FgPassInfo* pass  = &fg->m_passinfo_array[i];
+                s32         count = 0;
+                count             = s_bits_append(mask, count, pass->m_texture[FgCreate], fg->m_textureinfo_crw_array[FgCreate], 0);
+                count             = s_bits_append(mask, count, pass->m_texture[FgWrite], fg->m_textureinfo_crw_array[FgWrite], 0);
+                count             = s_bits_append(mask, count, pass->m_buffer[FgCreate], fg->m_bufferinfo_crw_array[FgCreate], texture_count);
+                count             = s_bits_append(mask, count, pass->m_buffer[FgWrite], fg->m_bufferinfo_crw_array[FgWrite], texture_count);
+
+                bool const anchored = pass->m_final == 1 || (pass->m_flags & HAS_SIDE_EFFECTS) == HAS_SIDE_EFFECTS;
+                bool const used     = s_bits_intersect(live, mask, count);
+                pass->m_ref_count   = used ? 1 : 0;
+                if (anchored || used || count == 0)
+                {
+                    count = s_bits_append(mask, 0, pass->m_texture[FgRead], fg->m_textureinfo_crw_array[FgRead], 0);
+                    count = s_bits_append(mask, count, pass->m_buffer[FgRead], fg->m_bufferinfo_crw_array[FgRead], texture_count);
+                    s_bits_or(live, mask, count);
+                }
+            }
+
+            g_deallocate_array(allocator, live);
+            g_deallocate_array(allocator, mask.m_bits);
+            g_deallocate_array(allocator, mask.m_word);
+        }
+
+        static void s_resource_reset(FgResourceTable& table, u32 row, u32 count)
+        {
+            for (u32 i = row; i < row + count; ++i)
+            {
+                table.m_ref_count[i] = 0;
+                table.m_last[i]      = c_no_pass;
+                table.m_queues[i]    = 0;
+            }
+        }
+
+        // The pass (in execution order) uses the version in 'row', the queue of the pass is added to its root
+        static inline void s_resource_use(FgResourceTable& table, u32 row, u32 root, FgIndex pass, u16 queue)
+        {
+            table.m_last[row] = pass;
+            table.m_queues[root] |= queue;
+        }
+
+        // The number of passes on the longest chain of dependencies, the execution order is a topological order
+        static s32 s_longest_chain(Fg* fg, alloc_t* allocator)
+        {
+            s32* length  = g_allocate_array<s32>(allocator, fg->m_pass_array_size);
+            s32  longest = 0;
+            for (s32 k = 0; k < fg->m_order_count; ++k)
+                length[fg->m_order[k]] = 1;
+            for (s32 k = 0; k < fg->m_order_count; ++k)
+            {
+                FgPassInfo const* pass  = &fg->m_passinfo_array[fg->m_order[k]];
+                s32 const         chain = length[fg->m_order[k]];
+                longest                 = chain > longest ? chain : longest;
+                for (s32 j = pass->m_successors.begin; j < pass->m_successors.end; ++j)
+                {
+                    FgIndex const successor = fg->m_edge_array[j];
+                    length[successor]       = chain + 1 > length[successor] ? chain + 1 : length[successor];
+                }
+            }
+            g_deallocate_array(allocator, length);
+            return longest;
+        }
+
+        // Ref-counts, culling, dependencies, execution order, lifetimes, release lists, transitions and sync points, these only depend on the structure of the graph
+        static void s_compile_structure(Fg* fg, alloc_t* allocator)
+        {
+            FgResourceTable& table = fg->m_resources;
+
+            // Reset ref-counts and lifetimes
+            s_resource_reset(table, fg->texture_row(0), fg->m_textureinfo_cursor_main);
+            s_resource_reset(table, fg->buffer_row(0), fg->m_bufferinfo_cursor_main);
+
+            // Culling
+            {
+                FG_TRACE_SCOPE(fg, "culling", "compile", 0);
+                if (fg->m_bitset_culling)
+                    s_cull_bitset(fg, allocator);
+                else
+                    s_cull_ref_count(fg, allocator);
+            }
+
+            // Dependencies between the live passes
+            {
+                FG_TRACE_SCOPE(fg, "dependencies", "compile", 0);
+                s_build_dependencies(fg, allocator);
+            }
+
+            // Execution order of the live passes
+            {
+                FG_TRACE_SCOPE(fg, "schedule", "compile", 0);
+                s_build_schedule(fg, allocator);
+                fg->m_longest_chain = s_longest_chain(fg, allocator);
+            }
+
+            // Calculate resources lifetime
+            {
+                FG_TRACE_SCOPE(fg, "lifetimes", "compile", 0);
+                for (s32 k = 0; k < fg->m_order_count; ++k)
+                {
+                    FgIndex const     index = fg->m_order[k];
+                    FgPassInfo const* pass  = &fg->m_passinfo_array[index];
+                    u16 const         queue = (u16)(1 << pass->m_queue);
+
+                    // Created Textures and Buffers
+                    for (s32 j = pass->m_texture[FgCreate].begin; j < pass->m_texture[FgCreate].end; ++j)
+                    {
+                        u32 const row     = fg->texture_row(fg->m_textureinfo_crw_array[FgCreate][j]);
+                        table.m_pass[row] = index;
+                        s_resource_use(table, row, fg->texture_row(table.m_root[row]), index, queue);
+                    }
+                    for (s32 j = pass->m_buffer[FgCreate].begin; j < pass->m_buffer[FgCreate].end; ++j)
+                    {
+                        u32 const row     = fg->buffer_row(fg->m_bufferinfo_crw_array[FgCreate][j]);
+                        table.m_pass[row] = index;
+                        s_resource_use(table, row, fg->buffer_row(table.m_root[row]), index, queue);
+                    }
+
+                    // Read and written Textures and Buffers
+                    for (s32 t = FgRead; t <= FgWrite; ++t)
+                    {
+                        for (s32 j = pass->m_texture[t].begin; j < pass->m_texture[t].end; ++j)
+                        {
+                            u32 const row = fg->texture_row(fg->m_textureinfo_crw_array[t][j]);
+                            s_resource_use(table, row, fg->texture_row(table.m_root[row]), index, queue);
+                        }
+                        for (s32 j = pass->m_buffer[t].begin; j < pass->m_buffer[t].end; ++j)
+                        {
+                            u32 const row = fg->buffer_row(fg->m_bufferinfo_crw_array[t][j]);
+                            s_resource_use(table, row, fg->buffer_row(table.m_root[row]), index, queue);
+                        }
+                    }
+                }
+            }
+
+            // Release lists, per pass the transient (physical) resources that die after that pass
+            {
+                FG_TRACE_SCOPE(fg, "release lists", "compile", 0);
+                s32 const max_count = fg->m_textureinfo_cursor_main > fg->m_bufferinfo_cursor_main ? fg->m_textureinfo_cursor_main : fg->m_bufferinfo_cursor_main;
+                FgPass*   last      = g_allocate_array_and_clear<FgPass>(allocator, max_count);
+                s_build_release_lists(fg, fg->texture_row(0), fg->m_textureinfo_cursor_main, last, fg->m_textureinfo_release_array, &FgPassInfo::m_texture_release);
+                s_build_release_lists(fg, fg->buffer_row(0), fg->m_bufferinfo_cursor_main, last, fg->m_bufferinfo_release_array, &FgPassInfo::m_buffer_release);
+                g_deallocate_array(allocator, last);
+            }
+
+            // State transitions of the resources used by the live passes
+            {
+                FG_TRACE_SCOPE(fg, "transitions", "compile", 0);
+                s_build_transitions(fg, allocator);
+            }
+
+            // Sync points between passes on different queues
+            {
+                FG_TRACE_SCOPE(fg, "queue sync", "compile", 0);
+                s_build_queue_sync(fg, allocator);
+            }
+
+            // Merging of consecutive raster passes into render passes, load and store ops of the written textures
+            {
+                FG_TRACE_SCOPE(fg, "render passes", "compile", 0);
+                s_build_render_passes(fg, allocator);
+                s_build_attachment_ops(fg);
+            }
+        }
+
+        void fg_compile(Fg* fg, alloc_t* allocator)
+        {
+            ASSERT(fg->m_current_passinfo == nullptr);
+
+            if ((fg->m_pass_array_size == 0) && (fg->m_textureinfo_cursor_main == 0) && (fg->m_bufferinfo_cursor_main == 0))
+            {
+                fg->m_order_count   = 0;
+                fg->m_longest_chain = 0;
+                fg->m_compile_ticks = 0;
+                fg->m_compiled      = false;
+                return;
+            }
+
+#if FG_TRACE
+            u64 const compile_begin = fg->m_trace.m_clock.Call();
+#endif
+
+            // The same passes and accesses as the last compiled frame, the structural results are still valid
+            bool cached         = fg->m_compiled && fg->m_compiled_hash == fg->m_structure_hash;
+            fg->m_compiled      = true;
+            fg->m_compiled_hash = fg->m_structure_hash;
+
+            // The memory-aware schedule depends on the memory requirements of the transients
+            if (cached && fg->m_memory_schedule && s_hash_memory(fg) != fg->m_compiled_memory_hash)
+                cached = false;
+
+            // Compile memory comes from the scratch region of the graph, or from 'allocator' when there is none or it
+            // is too small, the allocations made with 'allocator' are counted
+            FgCountingAlloc compile_allocator(allocator, &fg->m_allocation_count);
+            fg->m_scratch.m_cursor   = 0;
+            fg->m_scratch.m_fallback = &compile_allocator;
+            alloc_t* scratch         = fg->m_scratch.m_capacity > 0 ? (alloc_t*)&fg->m_scratch : (alloc_t*)&compile_allocator;
+
+            FG_TRACE_SCOPE(fg, "fg_compile", "compile", 0);
+            if (!cached)
+                s_compile_structure(fg, scratch);
+
+            // Take physical transients from the pools, they then do not have to be created
+            if (fg->m_texture_pool.m_capacity > 0)
+            {
+                for (u32 j = 0; j < fg->m_pass_array_size; ++j)
+                {
+                    FgPassInfo const* pass = &fg->m_passinfo_array[j];
+                    for (s32 k = pass->m_texture_release.begin; k < pass->m_texture_release.end; ++k)
+                    {
+                        FgIndex const index = fg->m_textureinfo_release_array[k];
+                        u32 const     row   = fg->texture_row(index);
+                        if ((fg->m_resources.m_flags[row] & POOLED) == POOLED)
+                            continue;
+                        GfxTexture* pooled = s_pool_acquire<GfxTexture>(fg->m_texture_pool, fg->m_equal_texture, fg->m_hash_texture.Call(fg->texture_descr(index)), fg->texture_descr(index));
+                        if (pooled != nullptr)
+                        {
+                            fg->m_resources.m_object[row] = pooled;
+                            fg->m_resources.m_flags[row] |= POOLED;
+                            fg->m_pool_taken = true;
+                        }
+                    }
+                }
+            }
+            if (fg->m_buffer_pool.m_capacity > 0)
+            {
+                for (u32 j = 0; j < fg->m_pass_array_size; ++j)
+                {
+                    FgPassInfo const* pass = &fg->m_passinfo_array[j];
+                    for (s32 k = pass->m_buffer_release.begin; k < pass->m_buffer_release.end; ++k)
+                    {
+                        FgIndex const index = fg->m_bufferinfo_release_array[k];
+                        u32 const     row   = fg->buffer_row(index);
+                        if ((fg->m_resources.m_flags[row] & POOLED) == POOLED)
+                            continue;
+                        GfxBuffer* pooled = s_pool_acquire<GfxBuffer>(fg->m_buffer_pool, fg->m_equal_buffer, fg->m_hash_buffer.Call(fg->buffer_descr(index)), fg->buffer_descr(index));
+                        if (pooled != nullptr)
+                        {
+                            fg->m_resources.m_object[row] = pooled;
+                            fg->m_resources.m_flags[row] |= POOLED;
+                            fg->m_pool_taken = true;
+                        }
+                    }
+                }
+            }
+
+            s_resolve_transitions(fg);
+
+            // Memory aliasing of the physical transients, the placements are kept when the memory requirements did not change
+            if (fg->m_aliasing_texture || fg->m_aliasing_buffer || fg->m_memory_schedule)
+            {
+                u64 const memory_hash = s_hash_memory(fg);
+                if ((fg->m_aliasing_texture || fg->m_aliasing_buffer) && (!cached || memory_hash != fg->m_compiled_memory_hash))
+                {
+                    FG_TRACE_SCOPE(fg, "aliasing", "compile", 0);
+                    s_plan_aliasing(fg, scratch);
+                    s_build_alias_edges(fg, scratch);
+                }
+                fg->m_compiled_memory_hash = memory_hash;
+            }
+
+#if FG_TRACE
+            fg->m_compile_ticks = fg->m_trace.m_clock.Call() - compile_begin;
+#else
+            fg->m_compile_ticks = 0;
+#endif
+        }
+
+        FgPlacement fg_get_placement(Fg* fg, FgTexture resource)
+        {
+            ASSERT(fg->is_valid(resource));
+            if (!fg->m_aliasing_texture)
+                return {-1, 0, 0};
+            return fg->m_textureinfo_placement[fg->m_resources.m_root[fg->texture_row(resource.index)]];
+        }
+
+        FgPlacement fg_get_placement(Fg* fg, FgBuffer resource)
+        {
+            ASSERT(fg->is_valid(resource));
+            if (!fg->m_aliasing_buffer)
+                return {-1, 0, 0};
+            return fg->m_bufferinfo_placement[fg->m_resources.m_root[fg->buffer_row(resource.index)]];
+        }
+
+        u64  fg_get_structure_hash(Fg* fg) { return fg->m_structure_hash; }
+        bool fg_is_culled(Fg*, FgPass pass) { return s_is_culled(pass); }
+
+        void fg_get_stats(Fg* fg, FgStats* stats)
+        {
+            FgResourceTable const& table = fg->m_resources;
+
+            stats->m_pass_count      = fg->m_pass_array_size;
+            stats->m_culled_count    = fg->m_pass_array_size - fg->m_order_count;
+            stats->m_executed_count  = fg->m_executed_count;
+            stats->m_version_count   = fg->m_textureinfo_cursor_main + fg->m_bufferinfo_cursor_main;
+            stats->m_physical_count  = 0;
+            stats->m_created_count   = fg->m_created_count;
+            stats->m_destroyed_count = fg->m_destroyed_count;
+            stats->m_longest_chain   = fg->m_longest_chain;
+            stats->m_peak_live       = 0;
+            stats->m_peak_live_bytes = 0;
+            stats->m_compile_ticks   = fg->m_compile_ticks;
+            stats->m_peak_declared   = fg->m_peak_declared;
+            stats->m_peak_scheduled  = fg->m_peak_scheduled;
+
+            for (s32 i = 0; i < fg->m_textureinfo_cursor_main; ++i)
+                stats->m_physical_count += table.m_root[fg->texture_row((FgIndex)i)] == i ? 1 : 0;
+            for (s32 i = 0; i < fg->m_bufferinfo_cursor_main; ++i)
+                stats->m_physical_count += table.m_root[fg->buffer_row((FgIndex)i)] == i ? 1 : 0;
+
+            // A transient lives from the pass that creates it up to the pass after which it is released
+            s32 live       = 0;
+            u64 live_bytes = 0;
+            for (s32 k = 0; k < fg->m_order_count; ++k)
+            {
+                FgPassInfo const* pass = &fg->m_passinfo_array[fg->m_order[k]];
+                for (s32 j = pass->m_texture[FgCreate].begin; j < pass->m_texture[FgCreate].end; ++j)
+                {
+                    FgMemoryRequirements req = {0, 1};
+                    fg->m_memory_texture.Call(fg->texture_descr(fg->m_textureinfo_crw_array[FgCreate][j]), &req);
+                    live += 1;
+                    live_bytes += req.m_size;
+                }
+                for (s32 j = pass->m_buffer[FgCreate].begin; j < pass->m_buffer[FgCreate].end; ++j)
+                {
+                    FgMemoryRequirements req = {0, 1};
+                    fg->m_memory_buffer.Call(fg->buffer_descr(fg->m_bufferinfo_crw_array[FgCreate][j]), &req);
+                    live += 1;
+                    live_bytes += req.m_size;
+                }
+                stats->m_peak_live       = live > stats->m_peak_live ? live : stats->m_peak_live;
+                stats->m_peak_live_bytes = live_bytes > stats->m_peak_live_bytes ? live_bytes : stats->m_peak_live_bytes;
+
+                for (s32 j = pass->m_texture_release.begin; j < pass->m_texture_release.end; ++j)
+                {
+                    FgMemoryRequirements req = {0, 1};
+                    fg->m_memory_texture.Call(fg->texture_descr(fg->m_textureinfo_release_array[j]), &req);
+                    live -= 1;
+                    live_bytes -= req.m_size;
+                }
+                for (s32 j = pass->m_buffer_release.begin; j < pass->m_buffer_release.end; ++j)
+                {
+                    FgMemoryRequirements req = {0, 1};
+                    fg->m_memory_buffer.Call(fg->buffer_descr(fg->m_bufferinfo_release_array[j]), &req);
+                    live -= 1;
+                    live_bytes -= req.m_size;
+                }
+            }
+        }
+
+        void fg_set_trace(Fg* fg, u32 capacity, callback_t<u64> clock)
+        {
+#if !FG_TRACE
+            capacity = 0;
+#endif
+            g_deallocate_array(fg->m_allocator, fg->m_trace.m_events);
+            fg->m_trace.m_events   = capacity > 0 ? g_allocate_array_and_clear<FgTraceEvent>(fg->m_allocator, capacity) : nullptr;
+            fg->m_trace.m_capacity = capacity;
+            fg->m_trace.m_cursor   = 0;
+            fg->m_trace.m_clock    = clock;
+        }
+
+        void fg_clear_trace(Fg* fg) { fg->m_trace.m_cursor = 0; }
+
+        // The most recent events in the ring, at most 'max_count', returns the number of events and the oldest one
+        static u32 s_trace_window(FgTrace const& trace, u32 max_count, u32& first)
+        {
+            u32 const written = (u32)trace.m_cursor;
+            u32       count   = written < trace.m_capacity ? written : trace.m_capacity;
+            count             = count < max_count ? count : max_count;
+            first             = written - count;
+            return count;
+        }
+
+        s32 fg_get_trace(Fg* fg, FgTraceEvent* events, s32 max_count)
+        {
+            u32       first;
+            u32 const count = s_trace_window(fg->m_trace, (u32)max_count, first);
+            for (u32 i = 0; i < count; ++i)
+                events[i] = fg->m_trace.m_events[(first + i) % fg->m_trace.m_capacity];
+            return (s32)count;
+        }
+
+        // Text output of the exports, buffered and written in pieces through the callback
+        struct FgTextWriter
+        {
+            callback_t<void, const char*, u32> m_write;
+            u32                                m_size;
+            char                               m_buffer[256];
+
+            void flush()
+            {
+                if (m_size > 0)
+                    m_write.Call(m_buffer, m_size);
+                m_size = 0;
+            }
+
+            void put(char c)
+            {
+                if (m_size == sizeof(m_buffer))
+                    flush();
+                m_buffer[m_size++] = c;
+            }
+
+            void text(const char* str)
+            {
+                while (*str != 0)
+                    put(*str++);
+            }
+
+            // Quotes and backslashes escaped and control characters replaced
+            void escaped(const char* str)
+            {
+                for (; str != nullptr && *str != 0; ++str)
+                {
+                    if (*str == '"' || *str == '\\')
+                        put('\\');
+                    put((u8)*str < 0x20 ? ' ' : *str);
+                }
+            }
+
+            void string(const char* str)
+            {
+                put('"');
+                escaped(str);
+                put('"');
+            }
+
+            void number(u64 value)
+            {
+                char digits[20];
+                s32  count = 0;
+                do
+                {
+                    digits[count++] = (char)('0' + (value % 10));
+                    value /= 10;
+                } while (value != 0);
+                while (count > 0)
+                    put(digits[--count]);
+            }
+
+            void integer(s64 value)
+            {
+                if (value < 0)
+                    put('-');
+                number(value < 0 ? (u64)(-value) : (u64)value);
+            }
+
+            // Ticks as microseconds with three decimals
+            void microseconds(u64 ticks, u64 ticks_per_us)
+            {
+                number(ticks / ticks_per_us);
+                u64 const fraction = ((ticks % ticks_per_us) * 1000) / ticks_per_us;
+                put('.');
+                put((char)('0' + fraction / 100));
+                put((char)('0' + (fraction / 10) % 10));
+                put((char)('0' + fraction % 10));
+            }
+        };
+
+        void fg_export_trace(Fg* fg, callback_t<void, const char*, u32> write, u64 ticks_per_us)
+        {
+            ASSERT(ticks_per_us > 0);
+
+            FgTextWriter out;
+            out.m_write = write;
+            out.m_size  = 0;
+
+            u32       first;
+            u32 const count = s_trace_window(fg->m_trace, fg->m_trace.m_capacity, first);
+
+            // Complete events ("ph":"X"), nested scopes on the same thread show up as a stack
+            out.text("{\"traceEvents\":[");
+            for (u32 i = 0; i < count; ++i)
+            {
+                FgTraceEvent const* event = &fg->m_trace.m_events[(first + i) % fg->m_trace.m_capacity];
+                out.text(i == 0 ? "\n{\"name\":" : ",\n{\"name\":");
+                out.string(event->m_name);
+                out.text(",\"cat\":");
+                out.string(event->m_category);
+                out.text(",\"ph\":\"X\",\"ts\":");
+                out.microseconds(event->m_begin, ticks_per_us);
+                out.text(",\"dur\":");
+                out.microseconds(event->m_end - event->m_begin, ticks_per_us);
+                out.text(",\"pid\":0,\"tid\":");
+                out.number((u64)event->m_thread);
+                out.put('}');
+            }
+            out.text("\n]}\n");
+            out.flush();
+        }
+
+        // The pass after which the physical resource 'root' is released, -1 when it is not released (imported, culled)
+        static s32 s_release_pass(Fg* fg, FgIndex root, bool buffer)
+        {
+            FgIndex const* release = buffer ? fg->m_bufferinfo_release_array : fg->m_textureinfo_release_array;
+            for (u32 i = 0; i < fg->m_pass_array_size; ++i)
+            {
+                FgPassInfo const* pass  = &fg->m_passinfo_array[i];
+                FgRange const     range = buffer ? pass->m_buffer_release : pass->m_texture_release;
+                for (s32 j = range.begin; j < range.end; ++j)
                 {
-                    FgPassInfo* pass  = &fg->m_passinfo_array[i];
-                    pass->m_ref_count = static_cast<s32>(pass->m_texture[FgWrite].size()) + static_cast<s32>(pass->m_buffer[FgWrite].size());
+                    if (release[j] == root)
+                        return i;
+                }
+            }
+            return -1;
+        }
 
-                    // Texture and Buffer read
-                    for (s32 j = pass->m_texture[FgRead].begin; j < pass->m_texture[FgRead].end; ++j)
-                    {
-                        FgIndex const  index    = fg->m_textureinfo_crw_array[FgRead][j];
-                        FgTextureInfo* consumed = &fg->m_textureinfo_array[index];
-                        consumed->m_resource.m_ref_count++;
-                    }
-                    for (s32 j = pass->m_buffer[FgRead].begin; j < pass->m_buffer[FgRead].end; ++j)
+        // Versions are named 't<index>' and 'b<index>' in both exports
+        static void s_export_id(FgTextWriter& out, FgIndex index, bool buffer)
+        {
+            out.put(buffer ? 'b' : 't');
+            out.number(index);
+        }
+
+        static void s_export_dot_versions(Fg* fg, FgTextWriter& out, bool buffer)
+        {
+            FgResourceTable const& table = fg->m_resources;
+            s32 const              count = buffer ? fg->m_bufferinfo_cursor_main : fg->m_textureinfo_cursor_main;
+            for (s32 i = 0; i < count; ++i)
+            {
+                s32 const     row     = buffer ? fg->buffer_row((FgIndex)i) : fg->texture_row((FgIndex)i);
+                FgIndex const root    = table.m_root[row];
+                FgPass const  creator = fg->pass_at(table.m_pass[row]);
+
+                out.text("    ");
+                s_export_id(out, (FgIndex)i, buffer);
+                if (table.m_flags[row] & IMPORTED)
+                    out.text(" [shape=ellipse, style=bold, label=\"");
+                else if (creator != nullptr && s_is_culled(creator))
+                    out.text(" [shape=ellipse, style=dashed, color=gray, label=\"");
+                else
+                    out.text(" [shape=ellipse, label=\"");
+                out.escaped(table.m_name[row]);
+                out.text("\\n");
+                s_export_id(out, (FgIndex)i, buffer);
+                if (root != i)
+                {
+                    out.text(" of ");
+                    s_export_id(out, root, buffer);
+                }
+
+                // The lifetime in execution positions and the memory of a physical transient
+                if (root == i && creator != nullptr && !s_is_culled(creator))
+                {
+                    s32 const last = s_release_pass(fg, root, buffer);
+                    out.text("\\nlive #");
+                    out.integer(s_first_position(creator));
+                    out.text("..#");
+                    out.integer(last < 0 ? -1 : s_last_position(&fg->m_passinfo_array[last]));
+
+                    bool const        aliasing  = buffer ? fg->m_aliasing_buffer : fg->m_aliasing_texture;
+                    FgPlacement const placement = buffer ? fg->m_bufferinfo_placement[root] : fg->m_textureinfo_placement[root];
+                    if (aliasing && placement.m_heap >= 0)
                     {
-                        FgIndex const index    = fg->m_bufferinfo_crw_array[FgRead][j];
-                        FgBufferInfo* consumed = &fg->m_bufferinfo_array[index];
-                        consumed->m_resource.m_ref_count++;
+                        out.text("\\nheap ");
+                        out.integer(placement.m_heap);
+                        out.text(" @ ");
+                        out.number(placement.m_offset);
+                        out.text(", ");
+                        out.number(placement.m_size);
+                        out.text(" bytes");
                     }
+                }
+                out.text("\"];\n");
+            }
+        }
+
+        static bool s_created_by(Fg* fg, FgPassInfo const* pass, FgIndex index, bool buffer)
+        {
+            FgRange const  range  = buffer ? pass->m_buffer[FgCreate] : pass->m_texture[FgCreate];
+            FgIndex const* create = buffer ? fg->m_bufferinfo_crw_array[FgCreate] : fg->m_textureinfo_crw_array[FgCreate];
+            for (s32 j = range.begin; j < range.end; ++j)
+            {
+                if (create[j] == index)
+                    return true;
+            }
+            return false;
+        }
 
-                    // Texture and Buffer write, assign producer
-                    for (s32 j = pass->m_texture[FgWrite].begin; j < pass->m_texture[FgWrite].end; ++j)
+        static void s_export_dot_edges(Fg* fg, FgTextWriter& out, FgPassInfo const* pass, s32 p, bool buffer)
+        {
+            FgIndex* const* crw = buffer ? fg->m_bufferinfo_crw_array : fg->m_textureinfo_crw_array;
+            for (s32 a = FgCreate; a <= FgWrite; ++a)
+            {
+                FgRange const range = buffer ? pass->m_buffer[a] : pass->m_texture[a];
+                for (s32 j = range.begin; j < range.end; ++j)
+                {
+                    if (a == FgWrite && s_created_by(fg, pass, crw[FgWrite][j], buffer))
+                        continue; // the create edge already connects them
+                    out.text("    ");
+                    if (a == FgRead)
                     {
-                        FgIndex const   index    = fg->m_textureinfo_crw_array[FgWrite][j];
-                        FgResourceInfo* resource = &fg->m_textureinfo_array[index].m_resource;
-                        resource->m_pass         = pass;
-                        resource->m_ref_count += (pass->m_final == 1) ? 1 : 0;
+                        s_export_id(out, crw[a][j], buffer);
+                        out.text(" -> p");
+                        out.integer(p);
                     }
-                    for (s32 j = pass->m_buffer[FgWrite].begin; j < pass->m_buffer[FgWrite].end; ++j)
+                    else
                     {
-                        FgIndex const   index    = fg->m_bufferinfo_crw_array[FgWrite][j];
-                        FgResourceInfo* resource = &fg->m_bufferinfo_array[index].m_resource;
-                        resource->m_pass         = pass;
-                        resource->m_ref_count += (pass->m_final == 1) ? 1 : 0;
+                        out.put('p');
+                        out.integer(p);
+                        out.text(" -> ");
+                        s_export_id(out, crw[a][j], buffer);
                     }
+                    out.text(a == FgCreate ? " [style=bold];\n" : ";\n");
                 }
             }
+        }
 
-            // Culling
+        void fg_export_dot(Fg* fg, callback_t<void, const char*, u32> write)
+        {
+            FgTextWriter out;
+            out.m_write = write;
+            out.m_size  = 0;
+
+            out.text("digraph framegraph\n{\n    rankdir=LR;\n    node [fontname=\"Helvetica\", fontsize=10];\n");
+
+            // Passes are boxes with their execution position and queue, culled passes and their versions are dashed
+            for (u32 i = 0; i < fg->m_pass_array_size; ++i)
             {
-                // Textures
-                s32              stack_size     = 0;
-                s32 const        max_stack_size = fg->m_textureinfo_cursor_main + fg->m_bufferinfo_cursor_main;
-                FgResourceInfo** stack          = g_allocate_array_and_clear<FgResourceInfo*>(allocator, max_stack_size);
-                for (s32 i = 0; i < fg->m_textureinfo_cursor_main; ++i)
+                FgPassInfo const* pass = &fg->m_passinfo_array[i];
+                out.text("    p");
+                out.integer(i);
+                out.text(s_is_culled(pass) ? " [shape=box, style=dashed, color=gray, label=\"" : " [shape=box, label=\"");
+                out.escaped(pass->m_name);
+                if (s_is_culled(pass))
                 {
-                    FgResourceInfo* resource = &fg->m_textureinfo_array[i].m_resource;
-                    if (resource->m_ref_count == 0)
-                        stack[stack_size++] = resource;
+                    out.text("\\nculled");
                 }
-                for (s32 i = 0; i < fg->m_bufferinfo_cursor_main; ++i)
+                else
                 {
-                    FgResourceInfo* resource = &fg->m_bufferinfo_array[i].m_resource;
-                    if (resource->m_ref_count == 0)
-                        stack[stack_size++] = resource;
+                    out.text("\\n#");
+                    out.integer(pass->m_position);
+                    out.text(" queue ");
+                    out.number(pass->m_queue);
+                    if (pass->m_subpass >= 0)
+                    {
+                        out.text(" subpass ");
+                        out.integer(pass->m_subpass);
+                    }
+                    if (pass->m_transitions_end.end > pass->m_transitions.begin)
+                    {
+                        out.text("\\nbarriers ");
+                        out.integer(pass->m_transitions_end.end - pass->m_transitions.begin);
+                    }
                 }
+                out.text("\"];\n");
+            }
+            s_export_dot_versions(fg, out, false);
+            s_export_dot_versions(fg, out, true);
 
-                while (stack_size > 0)
-                {
-                    FgResourceInfo* rsc      = stack[--stack_size];
-                    FgPassInfo*     producer = rsc->m_pass;
-                    if (producer == nullptr || ((producer->m_flags & HAS_SIDE_EFFECTS) == HAS_SIDE_EFFECTS))
-                        continue;
+            for (u32 i = 0; i < fg->m_pass_array_size; ++i)
+            {
+                FgPassInfo const* pass = &fg->m_passinfo_array[i];
+                s_export_dot_edges(fg, out, pass, i, false);
+                s_export_dot_edges(fg, out, pass, i, true);
+            }
+            out.text("}\n");
+            out.flush();
+        }
+
+        static void s_export_json_list(FgTextWriter& out, const char* key, FgRange range, FgIndex const* array, bool buffer)
+        {
+            out.text(",\"");
+            out.text(key);
+            out.text("\":[");
+            for (s32 j = range.begin; j < range.end; ++j)
+            {
+                out.text(j == range.begin ? "\"" : ",\"");
+                s_export_id(out, array[j], buffer);
+                out.put('"');
+            }
+            out.put(']');
+        }
+
+        static void s_export_json_versions(Fg* fg, FgTextWriter& out, bool buffer, bool& first)
+        {
+            FgResourceTable const& table    = fg->m_resources;
+            s32 const              count    = buffer ? fg->m_bufferinfo_cursor_main : fg->m_textureinfo_cursor_main;
+            bool const             aliasing = buffer ? fg->m_aliasing_buffer : fg->m_aliasing_texture;
+            for (s32 i = 0; i < count; ++i)
+            {
+                s32 const     row  = buffer ? fg->buffer_row((FgIndex)i) : fg->texture_row((FgIndex)i);
+                FgIndex const root = table.m_root[row];
 
-                    ASSERT(producer->m_ref_count >= 1);
-                    if (--producer->m_ref_count == 0 && producer->m_final == 0)
+                out.text(first ? "\n{\"id\":\"" : ",\n{\"id\":\"");
+                first = false;
+                s_export_id(out, (FgIndex)i, buffer);
+                out.text("\",\"name\":");
+                out.string(table.m_name[row]);
+                out.text(",\"root\":\"");
+                s_export_id(out, root, buffer);
+                out.text("\",\"pass\":");
+                out.integer(table.m_pass[row] == c_no_pass ? -1 : (s64)table.m_pass[row]);
+                out.text((table.m_flags[row] & IMPORTED) ? ",\"imported\":true" : ",\"imported\":false");
+                out.text((table.m_flags[row] & TRANSIENT) ? ",\"transient\":true" : ",\"transient\":false");
+                if (root == i)
+                {
+                    out.text(",\"released\":");
+                    out.integer(s_release_pass(fg, root, buffer));
+                    FgPlacement const placement = buffer ? fg->m_bufferinfo_placement[root] : fg->m_textureinfo_placement[root];
+                    if (aliasing && placement.m_heap >= 0)
                     {
-                        for (s32 j = producer->m_texture[FgRead].begin; j < producer->m_texture[FgRead].end; ++j)
-                        {
-                            FgIndex const  index    = fg->m_textureinfo_crw_array[FgRead][j];
-                            FgTextureInfo* consumed = &fg->m_textureinfo_array[index];
-                            if (--consumed->m_resource.m_ref_count == 0)
-                                stack[stack_size++] = &consumed->m_resource;
-                        }
-                        for (s32 j = producer->m_buffer[FgRead].begin; j < producer->m_buffer[FgRead].end; ++j)
-                        {
-                            FgIndex const index    = fg->m_bufferinfo_crw_array[FgRead][j];
-                            FgBufferInfo* consumed = &fg->m_bufferinfo_array[index];
-                            if (--consumed->m_resource.m_ref_count == 0)
-                                stack[stack_size++] = &consumed->m_resource;
-                        }
+                        out.text(",\"heap\":");
+                        out.integer(placement.m_heap);
+                        out.text(",\"offset\":");
+                        out.number(placement.m_offset);
+                        out.text(",\"size\":");
+                        out.number(placement.m_size);
                     }
-                    g_deallocate_array(allocator, stack);
                 }
+                out.put('}');
+            }
+        }
 
-                // Calculate resources lifetime
-                {
-                    for (s32 i = 0; i < fg->m_pass_array_size; ++i)
-                    {
-                        FgPassInfo* pass = &fg->m_passinfo_array[i];
-                        if (pass->m_ref_count == 0 && pass->m_final == 0)
-                            continue;
+        void fg_export_json(Fg* fg, callback_t<void, const char*, u32> write)
+        {
+            FgTextWriter out;
+            out.m_write = write;
+            out.m_size  = 0;
 
-                        // Created Textures and Buffers
-                        for (s32 j = pass->m_texture[FgCreate].begin; j < pass->m_texture[FgCreate].end; ++j)
-                        {
-                            FgIndex const index                              = fg->m_textureinfo_crw_array[FgCreate][j];
-                            fg->m_textureinfo_array[index].m_resource.m_pass = pass;
-                        }
-                        for (s32 j = pass->m_buffer[FgCreate].begin; j < pass->m_buffer[FgCreate].end; ++j)
-                        {
-                            FgIndex const index                             = fg->m_bufferinfo_crw_array[FgCreate][j];
-                            fg->m_bufferinfo_array[index].m_resource.m_pass = pass;
-                        }
+            out.text("{\"passes\":[");
+            for (u32 i = 0; i < fg->m_pass_array_size; ++i)
+            {
+                FgPassInfo const* pass = &fg->m_passinfo_array[i];
+                out.text(i == 0 ? "\n{\"index\":" : ",\n{\"index\":");
+                out.integer(i);
+                out.text(",\"name\":");
+                out.string(pass->m_name);
+                out.text(s_is_culled(pass) ? ",\"culled\":true" : ",\"culled\":false");
+                out.text(",\"position\":");
+                out.integer(pass->m_position);
+                out.text(",\"queue\":");
+                out.number(pass->m_queue);
+                out.text(",\"subpass\":");
+                out.integer(pass->m_subpass);
 
-                        // Read Textures and Buffers
-                        for (s32 j = pass->m_texture[FgRead].begin; j < pass->m_texture[FgRead].end; ++j)
-                        {
-                            FgIndex const index                              = fg->m_textureinfo_crw_array[FgRead][j];
-                            fg->m_textureinfo_array[index].m_resource.m_last = pass;
-                        }
-                        for (s32 j = pass->m_buffer[FgRead].begin; j < pass->m_buffer[FgRead].end; ++j)
-                        {
-                            FgIndex const index                             = fg->m_bufferinfo_crw_array[FgRead][j];
-                            fg->m_bufferinfo_array[index].m_resource.m_last = pass;
-                        }
+                out.text(",\"successors\":[");
+                for (s32 j = pass->m_successors.begin; j < pass->m_successors.end; ++j)
+                {
+                    if (j != pass->m_successors.begin)
+                        out.put(',');
+                    out.number(fg->m_edge_array[j]);
+                }
+                out.text("],\"waits\":[");
+                for (s32 j = pass->m_waits.begin; j < pass->m_waits.end; ++j)
+                {
+                    out.text(j == pass->m_waits.begin ? "{\"queue\":" : ",{\"queue\":");
+                    out.number(fg->m_sync_array[j].m_queue);
+                    out.text(",\"value\":");
+                    out.number(fg->m_sync_array[j].m_value);
+                    out.put('}');
+                }
+                out.put(']');
 
-                        // Written Textures and Buffers
-                        for (s32 j = pass->m_texture[FgWrite].begin; j < pass->m_texture[FgWrite].end; ++j)
-                        {
-                            FgIndex const index                              = fg->m_textureinfo_crw_array[FgWrite][j];
-                            fg->m_textureinfo_array[index].m_resource.m_last = pass;
-                        }
-                        for (s32 j = pass->m_buffer[FgWrite].begin; j < pass->m_buffer[FgWrite].end; ++j)
-                        {
-                            FgIndex const index                             = fg->m_bufferinfo_crw_array[FgWrite][j];
-                            fg->m_bufferinfo_array[index].m_resource.m_last = pass;
-                        }
-                    }
+                // The accesses, and the lifetimes as the physical resources created and released by the pass
+                s_export_json_list(out, "creates", pass->m_texture[FgCreate], fg->m_textureinfo_crw_array[FgCreate], false);
+                s_export_json_list(out, "reads", pass->m_texture[FgRead], fg->m_textureinfo_crw_array[FgRead], false);
+                s_export_json_list(out, "writes", pass->m_texture[FgWrite], fg->m_textureinfo_crw_array[FgWrite], false);
+                s_export_json_list(out, "releases", pass->m_texture_release, fg->m_textureinfo_release_array, false);
+                s_export_json_list(out, "buffer_creates", pass->m_buffer[FgCreate], fg->m_bufferinfo_crw_array[FgCreate], true);
+                s_export_json_list(out, "buffer_reads", pass->m_buffer[FgRead], fg->m_bufferinfo_crw_array[FgRead], true);
+                s_export_json_list(out, "buffer_writes", pass->m_buffer[FgWrite], fg->m_bufferinfo_crw_array[FgWrite], true);
+                s_export_json_list(out, "buffer_releases", pass->m_buffer_release, fg->m_bufferinfo_release_array, true);
+
+                // The barriers before the pass, split transitions began after an earlier pass
+                out.text(",\"transitions\":[");
+                for (s32 k = pass->m_transitions.begin; k < pass->m_transitions_end.end; ++k)
+                {
+                    FgTransition const& transition = fg->m_transition_array[k];
+                    u32 const           resource   = fg->m_transition_resource[k];
+                    out.text(k == pass->m_transitions.begin ? "{\"resource\":\"" : ",{\"resource\":\"");
+                    s_export_id(out, (FgIndex)(resource & 0xFFFF), (resource & c_transition_buffer) != 0);
+                    out.text("\",\"before\":");
+                    out.number(transition.m_before.m_descr);
+                    out.text(",\"after\":");
+                    out.number(transition.m_after.m_descr);
+                    out.text(",\"mip\":");
+                    out.number(transition.m_range.m_mip);
+                    out.text(",\"mip_count\":");
+                    out.number(transition.m_range.m_mip_count);
+                    out.text(",\"slice\":");
+                    out.number(transition.m_range.m_slice);
+                    out.text(",\"slice_count\":");
+                    out.number(transition.m_range.m_slice_count);
+                    out.text(k >= pass->m_transitions.end ? ",\"split\":true}" : ",\"split\":false}");
                 }
+                out.text("]}");
             }
+
+            bool first = true;
+            out.text("\n],\"resources\":[");
+            s_export_json_versions(fg, out, false, first);
+            s_export_json_versions(fg, out, true, first);
+            out.text("\n]}\n");
+            out.flush();
         }
 
-        void fg_execute(Fg* fg, GfxRenderContext* ctxt)
+        s32 fg_get_heap_count(Fg* fg) { return fg->m_heap_count; }
+        u64 fg_get_heap_size(Fg* fg, s32 heap) { return (heap >= 0 && heap < fg->m_heap_count) ? fg->m_heap_size[heap] : 0; }
+
+        static void s_create_transients(Fg* fg, FgPassInfo* pass, GfxRenderContext* ctxt)
         {
-            for (s32 i = 0; i < fg->m_pass_array_size; ++i)
-            {
-                FgPassInfo* pass = &fg->m_passinfo_array[i];
-                if (pass->m_ref_count == 0 && !((pass->m_flags & HAS_SIDE_EFFECTS) == HAS_SIDE_EFFECTS) && !(pass->m_final == 1))
-                    continue;
+            if (pass->m_texture[FgCreate].size() == 0 && pass->m_buffer[FgCreate].size() == 0)
+                return;
 
-                // Create transient resources
-                for (s32 j = pass->m_texture[FgCreate].begin; j < pass->m_texture[FgCreate].end; ++j)
+            FG_TRACE_SCOPE(fg, pass->m_name, "create", 0);
+            for (s32 j = pass->m_texture[FgCreate].begin; j < pass->m_texture[FgCreate].end; ++j)
+            {
+                FgIndex const index = fg->m_textureinfo_crw_array[FgCreate][j];
+                if ((fg->m_resources.m_flags[fg->texture_row(index)] & POOLED) == 0)
                 {
-                    FgIndex        index   = fg->m_textureinfo_crw_array[FgCreate][j];
-                    FgTextureInfo* texture = &fg->m_textureinfo_array[index];
-                    fg->m_create_texture.Call(ctxt, texture->m_texture, texture->m_textureDescr);
+                    fg->m_create_texture.Call(ctxt, fg->physical_texture(index), fg->texture_descr(index));
+                    fg->m_created_count += 1;
                 }
-                for (s32 j = pass->m_buffer[FgCreate].begin; j < pass->m_buffer[FgCreate].end; ++j)
+            }
+            for (s32 j = pass->m_buffer[FgCreate].begin; j < pass->m_buffer[FgCreate].end; ++j)
+            {
+                FgIndex const index = fg->m_bufferinfo_crw_array[FgCreate][j];
+                if ((fg->m_resources.m_flags[fg->buffer_row(index)] & POOLED) == 0)
+                {
+                    fg->m_create_buffer.Call(ctxt, fg->physical_buffer(index), fg->buffer_descr(index));
+                    fg->m_created_count += 1;
+                }
+            }
+        }
+
+        // Is the physical texture written by one of the passes before 'passes[g]' in its merged render pass
+        static bool s_written_before(Fg* fg, FgPass const* passes, s32 g, FgIndex root)
+        {
+            for (s32 h = 0; h < g; ++h)
+            {
+                for (s32 j = passes[h]->m_texture[FgWrite].begin; j < passes[h]->m_texture[FgWrite].end; ++j)
                 {
-                    FgIndex       index  = fg->m_bufferinfo_crw_array[FgCreate][j];
-                    FgBufferInfo* buffer = &fg->m_bufferinfo_array[index];
-                    fg->m_create_buffer.Call(ctxt, buffer->m_buffer, buffer->m_bufferDescr);
+                    if (fg->m_resources.m_root[fg->texture_row(fg->m_textureinfo_crw_array[FgWrite][j])] == root)
+                        return true;
                 }
+            }
+            return false;
+        }
 
-                // Pre-read and pre-write
+        // Batched transitions or pre-read and pre-write of the pass 'passes[g]'. A subpass has no split transitions, and
+        // it does not pre-read the textures written earlier in its render pass (subpass dependencies).
+        static void s_pass_access(Fg* fg, FgPass const* passes, s32 g, GfxRenderContext* ctxt, bool split, s32 thread)
+        {
+            FgPassInfo* pass = passes[g];
+            FG_TRACE_SCOPE(fg, pass->m_name, "access", thread);
+            if (fg->m_batched_transitions)
+            {
+                // Without split transitions the ones that end at this pass are issued together with the others
+                s32 const begin = pass->m_transitions.begin;
+                s32 const end   = split ? pass->m_transitions.end : pass->m_transitions_end.end;
+                if (end > begin)
+                    fg->m_transitions.Call(ctxt, &fg->m_transition_array[begin], end - begin);
+                if (split && pass->m_transitions_end.size() > 0)
+                    fg->m_end_transitions.Call(ctxt, &fg->m_transition_array[pass->m_transitions_end.begin], pass->m_transitions_end.size());
+            }
+            else
+            {
                 for (s32 j = pass->m_texture[FgRead].begin; j < pass->m_texture[FgRead].end; ++j)
                 {
-                    if (!fg_flags_ignored(fg->m_textureinfo_flags[j]))
-                        fg->m_preread_texture.Call(ctxt, fg->m_textureinfo_array[j].m_texture, fg->m_textureinfo_flags[j]);
+                    FgFlags const flags = fg->m_textureinfo_crw_flags[FgRead][j];
+                    FgIndex const index = fg->m_textureinfo_crw_array[FgRead][j];
+                    if (!fg_flags_ignored(flags) && (g == 0 || !s_written_before(fg, passes, g, fg->m_resources.m_root[fg->texture_row(index)])))
+                        fg->m_preread_texture.Call(ctxt, fg->physical_texture(index), flags);
                 }
                 for (s32 j = pass->m_buffer[FgRead].begin; j < pass->m_buffer[FgRead].end; ++j)
                 {
-                    if (!fg_flags_ignored(fg->m_bufferinfo_flags[j]))
-                        fg->m_preread_buffer.Call(ctxt, fg->m_bufferinfo_array[j].m_buffer, fg->m_bufferinfo_flags[j]);
+                    FgFlags const flags = fg->m_bufferinfo_crw_flags[FgRead][j];
+                    if (!fg_flags_ignored(flags))
+                        fg->m_preread_buffer.Call(ctxt, fg->physical_buffer(fg->m_bufferinfo_crw_array[FgRead][j]), flags);
                 }
                 for (s32 j = pass->m_texture[FgWrite].begin; j < pass->m_texture[FgWrite].end; ++j)
                 {
-                    if (!fg_flags_ignored(fg->m_textureinfo_flags[j]))
-                        fg->m_prewrite_texture.Call(ctxt, fg->m_textureinfo_array[j].m_texture, fg->m_textureinfo_flags[j]);
+                    FgFlags const flags = fg->m_textureinfo_crw_flags[FgWrite][j];
+                    if (!fg_flags_ignored(flags))
+                    {
+                        FgIndex const index = fg->m_textureinfo_crw_array[FgWrite][j];
+                        fg->m_prewrite_texture.Call(ctxt, fg->physical_texture(index), flags);
+                        fg->m_prewrite_attachment.Call(ctxt, fg->physical_texture(index), flags, fg->m_textureinfo_ops[index]);
+                    }
                 }
                 for (s32 j = pass->m_buffer[FgWrite].begin; j < pass->m_buffer[FgWrite].end; ++j)
                 {
-                    if (!fg_flags_ignored(fg->m_bufferinfo_flags[j]))
-                        fg->m_prewrite_buffer.Call(ctxt, fg->m_bufferinfo_array[j].m_buffer, fg->m_bufferinfo_flags[j]);
+                    FgFlags const flags = fg->m_bufferinfo_crw_flags[FgWrite][j];
+                    if (!fg_flags_ignored(flags))
+                        fg->m_prewrite_buffer.Call(ctxt, fg->physical_buffer(fg->m_bufferinfo_crw_array[FgWrite][j]), flags);
                 }
+            }
+        }
+
+        // Executes a pass, or the 'count' passes of a merged render pass. The waits and the transitions of all its passes
+        // are issued before the render pass begins, the transitions between its subpasses are part of the render pass.
+        // The split transitions that begin after it and the signal follow after the render pass has ended.
+        static void s_execute_passes(Fg* fg, FgPass const* passes, s32 count, GfxRenderContext* ctxt, bool split, s32 thread)
+        {
+            FgPassInfo* head = passes[0];
+            FgPassInfo* last = passes[count - 1];
+
+            // Wait for the passes on other queues this pass depends on (a subpass does not wait)
+            if (head->m_waits.size() > 0)
+                fg->m_queue_wait.Call(ctxt, head->m_queue, &fg->m_sync_array[head->m_waits.begin], head->m_waits.size());
+
+            for (s32 g = 0; g < count; ++g)
+                s_pass_access(fg, passes, g, ctxt, split, thread);
+
+            FgRenderPass const render_pass = {passes, count, &fg->m_transition_array[head->m_subpass_dependencies.begin], head->m_subpass_dependencies.size()};
+            if (count > 1)
+                fg->m_begin_render_pass.Call(ctxt, &render_pass);
+
+            for (s32 g = 0; g < count; ++g)
+            {
+                FG_TRACE_SCOPE(fg, passes[g]->m_name, "execute", thread);
+                passes[g]->m_execute_fn.Call(fg, ctxt);
+            }
+
+            if (count > 1)
+                fg->m_end_render_pass.Call(ctxt, &render_pass);
+
+            // Only the last pass of a merged render pass begins split transitions or signals
+            if (split && last->m_transitions_begin.size() > 0)
+                fg->m_begin_transitions.Call(ctxt, &fg->m_transition_begin_array[last->m_transitions_begin.begin], last->m_transitions_begin.size());
 
-                // Execute pass
-                pass->m_execute_fn.Call(fg, ctxt);
+            if (last->m_signal)
+                fg->m_queue_signal.Call(ctxt, last->m_queue, last->m_value);
+        }
+
+        static void s_release_transients(Fg* fg, FgPassInfo* pass, GfxRenderContext* ctxt)
+        {
+            if (pass->m_texture_release.size() == 0 && pass->m_buffer_release.size() == 0)
+                return;
 
-                // Destroy transient resources
-                for (s32 j = 0; j < fg->m_textureinfo_cursor_main; ++j)
+            FG_TRACE_SCOPE(fg, pass->m_name, "destroy", 0);
+            for (s32 j = pass->m_texture_release.begin; j < pass->m_texture_release.end; ++j)
+            {
+                FgIndex const    index   = fg->m_textureinfo_release_array[j];
+                GfxTexture*      texture = fg->physical_texture(index);
+                GfxTextureDescr* descr   = fg->texture_descr(index);
+                if (fg->m_texture_pool.m_capacity == 0 || !s_pool_release(fg->m_texture_pool, fg->m_hash_texture.Call(descr), texture, descr, fg->m_frame_index))
                 {
-                    FgTextureInfo* texture = &fg->m_textureinfo_array[j];
-                    if (texture->m_resource.m_last == pass /* && texture is transient*/)
-                        fg->m_destroy_texture.Call(ctxt, texture->m_texture);
+                    fg->m_destroy_texture.Call(ctxt, texture);
+                    fg->m_destroyed_count += 1;
                 }
-                for (s32 j = 0; j < fg->m_bufferinfo_cursor_main; ++j)
+            }
+            for (s32 j = pass->m_buffer_release.begin; j < pass->m_buffer_release.end; ++j)
+            {
+                FgIndex const   index  = fg->m_bufferinfo_release_array[j];
+                GfxBuffer*      buffer = fg->physical_buffer(index);
+                GfxBufferDescr* descr  = fg->buffer_descr(index);
+                if (fg->m_buffer_pool.m_capacity == 0 || !s_pool_release(fg->m_buffer_pool, fg->m_hash_buffer.Call(descr), buffer, descr, fg->m_frame_index))
                 {
-                    FgBufferInfo* buffer = &fg->m_bufferinfo_array[j];
-                    if (buffer->m_resource.m_last == pass /* && buffer is transient*/)
-                        fg->m_destroy_buffer.Call(ctxt, buffer->m_buffer);
+                    fg->m_destroy_buffer.Call(ctxt, buffer);
+                    fg->m_destroyed_count += 1;
                 }
             }
         }
 
-        bool Fg::is_valid(FgTexture resource) const { return resource.index < m_textureinfo_cursor_main && resource.generation == m_resource_generation; }
-        bool Fg::is_valid(FgBuffer resource) const { return resource.index < m_bufferinfo_cursor_main && resource.generation == m_resource_generation; }
+        static void s_end_frame(Fg* fg, GfxRenderContext* ctxt)
+        {
+            // Destroy pooled resources that have not been used for a while
+            s_pool_evict(fg->m_texture_pool, fg->m_destroy_texture, ctxt, fg->m_frame_index, false);
+            s_pool_evict(fg->m_buffer_pool, fg->m_destroy_buffer, ctxt, fg->m_frame_index, false);
+            fg->m_frame_index++;
+        }
 
-        bool Fg::pass_contains(FgPass pass, FgType type, FgTexture resource) const
+        void fg_execute(Fg* fg, GfxRenderContext* ctxt)
         {
-            FgIndex* array = nullptr;
-            FgRange* range = nullptr;
-            switch (type)
+            fg->m_executed_count  = fg->m_order_count;
+            fg->m_created_count   = 0;
+            fg->m_destroyed_count = 0;
+            fg->m_pool_taken      = false; // the pooled transients go back to the pools when they are released
+            for (s32 k = 0; k < fg->m_order_count;)
             {
-                case FgCreate:
-                    array = m_textureinfo_crw_array[FgCreate];
-                    range = &pass->m_texture[FgCreate];
-                    break;
-                case FgRead:
-                    array = m_textureinfo_crw_array[FgRead];
-                    range = &pass->m_texture[FgRead];
-                    break;
-                case FgWrite:
-                    array = m_textureinfo_crw_array[FgWrite];
-                    range = &pass->m_texture[FgWrite];
-                    break;
-                default: ASSERT(false); break;
+                FgPass const* passes = &fg->m_order_pass[k];
+                s32 const     count  = passes[0]->m_subpass < 0 ? 1 : passes[0]->m_subpass_count;
+
+                // Transients of a merged render pass are created before it begins and released after it ends
+                for (s32 g = 0; g < count; ++g)
+                    s_create_transients(fg, passes[g], ctxt);
+                s_execute_passes(fg, passes, count, ctxt, fg->m_split_transitions, 0);
+                for (s32 g = 0; g < count; ++g)
+                    s_release_transients(fg, passes[g], ctxt);
+                k += count;
             }
-            for (s32 i = range->begin; i < range->end; ++i)
+            s_end_frame(fg, ctxt);
+        }
+
+        // The first pass of the merged render pass of a pass, the pass itself when it is not merged
+        static inline FgPassInfo* s_render_pass_head(Fg* fg, FgPassInfo* pass) { return pass->m_subpass <= 0 ? pass : fg->m_order_pass[pass->m_position - pass->m_subpass]; }
+
+        // Parallel execution, workers take passes from a shared ready queue. A merged render pass is one entry, it is
+        // recorded as a whole by one worker. Every live entry is pushed exactly once, so a worker can claim a slot in the
+        // queue up-front and wait for it to be filled. An entry is pushed by the worker that finished its last dependency,
+        // the dependencies include the alias edges (see s_build_alias_edges).
+        struct FgParallelExecute
+        {
+            Fg*                m_fg;
+            GfxRenderContext** m_ctxts;
+            s32                m_live_count; // the number of passes and merged render passes to execute
+            s32                m_head;
+            s32                m_tail;
+
+            void push(s32 pass_index)
             {
-                if (array[i] == resource.index)
-                    return true;
+                s32 const slot = s_atomic_add(&m_tail, 1) - 1;
+                s_atomic_store(&m_fg->m_ready_array[slot], pass_index);
             }
-            return false;
+
+            void release(FgPassInfo const* head, FgRange successors, FgIndex const* edges)
+            {
+                Fg* fg = m_fg;
+                for (s32 j = successors.begin; j < successors.end; ++j)
+                {
+                    FgPassInfo* successor = s_render_pass_head(fg, &fg->m_passinfo_array[edges[j]]);
+                    s32 const   index     = (s32)(successor - fg->m_passinfo_array);
+                    if (successor != head && s_atomic_add(&fg->m_pass_pending[index], -1) == 0)
+                        push(index);
+                }
+            }
+
+            void worker(s32 worker_index)
+            {
+                Fg* fg = m_fg;
+                while (true)
+                {
+                    s32 const slot = s_atomic_add(&m_head, 1) - 1;
+                    if (slot >= m_live_count)
+                        break;
+
+                    s32 pass_index;
+                    while ((pass_index = s_atomic_load(&fg->m_ready_array[slot])) < 0)
+                        s_cpu_pause();
+
+                    FgPassInfo*       head   = &fg->m_passinfo_array[pass_index];
+                    GfxRenderContext* ctxt   = m_ctxts[worker_index];
+                    FgPass const*     passes = &fg->m_order_pass[head->m_position];
+                    s32 const         count  = head->m_subpass < 0 ? 1 : head->m_subpass_count;
+
+                    s_execute_passes(fg, passes, count, ctxt, false, worker_index);
+
+                    for (s32 g = 0; g < count; ++g)
+                    {
+                        release(head, passes[g]->m_successors, fg->m_edge_array);
+                        release(head, passes[g]->m_alias_successors, fg->m_alias_edge_array);
+                    }
+                }
+            }
+        };
+
+        void fg_execute_parallel(Fg* fg, FgDispatchFn dispatch, GfxRenderContext** worker_ctxts, s32 worker_count)
+        {
+            ASSERT(worker_count > 0);
+
+            FgParallelExecute state;
+            state.m_fg         = fg;
+            state.m_ctxts      = worker_ctxts;
+            state.m_live_count = 0;
+            state.m_head       = 0;
+            state.m_tail       = 0;
+
+            fg->m_executed_count  = 0;
+            fg->m_created_count   = 0;
+            fg->m_destroyed_count = 0;
+            fg->m_pool_taken      = false;
+
+            for (u32 i = 0; i < fg->m_pass_array_size; ++i)
+            {
+                fg->m_ready_array[i]  = -1;
+                fg->m_pass_pending[i] = 0;
+            }
+
+            // Transients are created up-front and released after all passes have been recorded, the
+            // create/destroy callbacks (and the pools) are therefore only used from the calling thread.
+            // The dependencies of the passes of a merged render pass are counted at its first pass, except
+            // the ones between its own passes.
+            for (u32 i = 0; i < fg->m_pass_array_size; ++i)
+            {
+                FgPassInfo* pass = &fg->m_passinfo_array[i];
+                if (s_is_culled(pass))
+                    continue;
+                FgPassInfo* head  = s_render_pass_head(fg, pass);
+                s32 const   index = (s32)(head - fg->m_passinfo_array);
+                fg->m_pass_pending[index] += pass->m_dependencies + pass->m_alias_dependencies;
+                for (s32 j = pass->m_successors.begin; j < pass->m_successors.end; ++j)
+                    fg->m_pass_pending[index] -= s_render_pass_head(fg, &fg->m_passinfo_array[fg->m_edge_array[j]]) == head ? 1 : 0;
+                for (s32 j = pass->m_alias_successors.begin; j < pass->m_alias_successors.end; ++j)
+                    fg->m_pass_pending[index] -= s_render_pass_head(fg, &fg->m_passinfo_array[fg->m_alias_edge_array[j]]) == head ? 1 : 0;
+
+                state.m_live_count += head == pass ? 1 : 0;
+                fg->m_executed_count++;
+                s_create_transients(fg, pass, worker_ctxts[0]);
+            }
+            for (u32 i = 0; i < fg->m_pass_array_size; ++i)
+            {
+                FgPassInfo* pass = &fg->m_passinfo_array[i];
+                if (!s_is_culled(pass) && s_render_pass_head(fg, pass) == pass && fg->m_pass_pending[i] == 0)
+                    state.push(i);
+            }
+
+            dispatch.Call(FgWorkerFn(&state, &FgParallelExecute::worker), worker_count);
+
+            for (u32 i = 0; i < fg->m_pass_array_size; ++i)
+            {
+                FgPassInfo* pass = &fg->m_passinfo_array[i];
+                if (!s_is_culled(pass))
+                    s_release_transients(fg, pass, worker_ctxts[0]);
+            }
+            s_end_frame(fg, worker_ctxts[0]);
         }
 
-        bool Fg::pass_contains(FgPass pass, FgType type, FgBuffer resource) const
+        static const s32 c_max_pipeline_depth = 3;
+
+        // The graphs form a ring, frame N is declared in graph N % depth. The consumer owns the graphs of the frames from
+        // 'released' up to 'submitted', the producer the others. Each side only writes its own counter.
+        struct FgPipeline
+        {
+            DCORE_CLASS_PLACEMENT_NEW_DELETE
+
+            alloc_t* m_allocator;
+            s32      m_depth;
+            Fg*      m_graphs[c_max_pipeline_depth];
+
+            // Producer, the history state for the next frame (see fg_reset)
+            s32  m_submitted;
+            bool m_declaring;
+            u8   m_history_current[c_max_history];
+            u32  m_history_frames[c_max_history];
+
+            u8 m_padding[64]; // the counters of the producer and the consumer on different cache lines
+
+            // Consumer
+            s32  m_released;
+            bool m_executing;
+        };
+
+        FgPipeline* fg_pipeline_setup(alloc_t* allocator, s32 depth, u32 resource_capacity, u32 pass_capacity, u32 pass_data_capacity)
+        {
+            ASSERT(depth >= 1 && depth <= c_max_pipeline_depth);
+
+            FgPipeline* pipeline  = g_allocate_and_clear<FgPipeline>(allocator);
+            pipeline->m_allocator = allocator;
+            pipeline->m_depth     = depth;
+            for (s32 i = 0; i < depth; ++i)
+                pipeline->m_graphs[i] = fg_setup(allocator, resource_capacity, pass_capacity, pass_data_capacity);
+            return pipeline;
+        }
+
+        void fg_pipeline_teardown(FgPipeline*& pipeline)
         {
-            FgIndex* array = nullptr;
-            FgRange* range = nullptr;
-            switch (type)
+            for (s32 i = 0; i < pipeline->m_depth; ++i)
+                fg_teardown(pipeline->m_graphs[i]);
+            g_deallocate(pipeline->m_allocator, pipeline);
+            pipeline = nullptr;
+        }
+
+        s32 fg_pipeline_depth(FgPipeline* pipeline) { return pipeline->m_depth; }
+        Fg* fg_pipeline_graph(FgPipeline* pipeline, s32 index) { return pipeline->m_graphs[index]; }
+
+        FgHistory fg_pipeline_create_history(FgPipeline* pipeline, const char* name, GfxTexture* a, GfxTexture* b, GfxTextureDescr* descr)
+        {
+            FgHistory history = fg_create_history(pipeline->m_graphs[0], name, a, b, descr);
+            for (s32 i = 1; i < pipeline->m_depth; ++i)
+                fg_create_history(pipeline->m_graphs[i], name, a, b, descr);
+            pipeline->m_history_current[history.index] = 0;
+            pipeline->m_history_frames[history.index]  = 0;
+            return history;
+        }
+
+        Fg* fg_pipeline_begin(FgPipeline* pipeline)
+        {
+            ASSERT(!pipeline->m_declaring);
+
+            s32 const frame = pipeline->m_submitted;
+            if ((u32)(frame - s_atomic_load(&pipeline->m_released)) >= (u32)pipeline->m_depth)
+                return nullptr;
+
+            Fg* fg = pipeline->m_graphs[(u32)frame % (u32)pipeline->m_depth];
+            fg_reset(fg);
+
+            // The graph last declared a frame 'depth' frames ago, the history state is that of the previous frame
+            for (s32 i = 0; i < fg->m_history_count; ++i)
             {
-                case FgCreate:
-                    array = m_bufferinfo_crw_array[FgCreate];
-                    range = &pass->m_buffer[FgCreate];
-                    break;
-                case FgRead:
-                    array = m_bufferinfo_crw_array[FgRead];
-                    range = &pass->m_buffer[FgRead];
-                    break;
-                case FgWrite:
-                    array = m_bufferinfo_crw_array[FgWrite];
-                    range = &pass->m_buffer[FgWrite];
-                    break;
-                default: ASSERT(false); break;
+                fg->m_history[i].m_current = pipeline->m_history_current[i];
+                fg->m_history[i].m_frames  = pipeline->m_history_frames[i];
             }
-            for (s32 i = range->begin; i < range->end; ++i)
+
+            pipeline->m_declaring = true;
+            return fg;
+        }
+
+        void fg_pipeline_submit(FgPipeline* pipeline, alloc_t* allocator)
+        {
+            ASSERT(pipeline->m_declaring);
+
+            s32 const frame = pipeline->m_submitted;
+            Fg*       fg    = pipeline->m_graphs[(u32)frame % (u32)pipeline->m_depth];
+            fg_compile(fg, allocator);
+
+            // The swap of fg_reset, a frame that used the current texture of a history makes it the previous texture
+            for (s32 i = 0; i < fg->m_history_count; ++i)
             {
-                if (array[i] == resource.index)
-                    return true;
+                FgHistoryInfo const* history = &fg->m_history[i];
+                u32 const            used    = history->m_generation[history->m_current] == fg->m_resource_generation ? 1 : 0;
+                pipeline->m_history_current[i] = history->m_current ^ (u8)used;
+                pipeline->m_history_frames[i]  = history->m_frames + used;
             }
-            return false;
+
+            pipeline->m_declaring = false;
+            s_atomic_store(&pipeline->m_submitted, frame + 1);
+        }
+
+        Fg* fg_pipeline_acquire(FgPipeline* pipeline)
+        {
+            ASSERT(!pipeline->m_executing);
+
+            s32 const frame = pipeline->m_released;
+            if (frame == s_atomic_load(&pipeline->m_submitted))
+                return nullptr;
+
+            pipeline->m_executing = true;
+            return pipeline->m_graphs[(u32)frame % (u32)pipeline->m_depth];
+        }
+
+        void fg_pipeline_release(FgPipeline* pipeline)
+        {
+            ASSERT(pipeline->m_executing);
+            pipeline->m_executing = false;
+            s_atomic_store(&pipeline->m_released, pipeline->m_released + 1);
+        }
+
+        bool Fg::is_valid(FgTexture resource) const { return resource.index < m_textureinfo_cursor_main && resource.generation == m_resource_generation; }
+        bool Fg::is_valid(FgBuffer resource) const { return resource.index < m_bufferinfo_cursor_main && resource.generation == m_resource_generation; }
+
+        // A version remembers the last pass that accessed it and how, which makes these O(1)
+        bool Fg::pass_contains(FgPass pass, FgType type, FgTexture resource) const
+        {
+            u32 const access = m_resources.m_access[texture_row(resource.index)];
+            return (access & ~7u) == access_stamp(pass) && (access & (1 << type)) != 0;
+        }
+
+        bool Fg::pass_contains(FgPass pass, FgType type, FgBuffer resource) const
+        {
+            u32 const access = m_resources.m_access[buffer_row(resource.index)];
+            return (access & ~7u) == access_stamp(pass) && (access & (1 << type)) != 0;
+        }
+
+        void Fg::pass_mark(FgPass pass, FgType type, FgTexture resource)
+        {
+            u32& access = m_resources.m_access[texture_row(resource.index)];
+            if ((access & ~7u) != access_stamp(pass))
+                access = access_stamp(pass);
+            access |= 1 << type;
+        }
+
+        void Fg::pass_mark(FgPass pass, FgType type, FgBuffer resource)
+        {
+            u32& access = m_resources.m_access[buffer_row(resource.index)];
+            if ((access & ~7u) != access_stamp(pass))
+                access = access_stamp(pass);
+            access |= 1 << type;
         }
 
     } // namespace nframegraph
@@ -8,6 +8,15 @@
 #include "ccore/c_callback.h"
 #include "callocator/c_allocator_linear.h"
 
+// Timeline instrumentation of fg_compile and fg_execute (see fg_set_trace), 0 compiles the scopes out
+#ifndef FG_TRACE
+#    if defined(TARGET_FINAL)
+#        define FG_TRACE 0
+#    else
+#        define FG_TRACE 1
+#    endif
+#endif
+
 namespace ncore
 {
     struct GfxTexture;
@@ -56,6 +65,18 @@ namespace ncore
         static FgFlags s_flags_ignored = {0xFFFFFFFF};
         inline bool    fg_flags_ignored(FgFlags flags) { return flags.m_descr == s_flags_ignored.m_descr; }
 
+        // A range of mips and array slices of a texture, dependencies and transitions are tracked per subresource
+        struct FgSubresource
+        {
+            u16 m_mip;
+            u16 m_mip_count;
+            u16 m_slice;
+            u16 m_slice_count;
+        };
+        static FgSubresource s_subresource_all = {0, 0xFFFF, 0, 0xFFFF};
+        inline FgSubresource fg_mips(u16 mip, u16 count = 1) { return {mip, count, 0, 0xFFFF}; }
+        inline FgSubresource fg_slices(u16 slice, u16 count = 1) { return {0, 0xFFFF, slice, count}; }
+
         struct FgPassInfo;
         typedef FgPassInfo* FgPass;
         static const FgPass s_invalid_pass = nullptr;
@@ -69,7 +90,7 @@ namespace ncore
             FgIndex      index;
             FgGeneration generation;
         };
-        static const FgTexture s_invalid_texture = {0xFFFF};
+        static const FgTexture s_invalid_texture = {0xFFFF, 0};
 
         struct FgBufferInfo;
         struct FgBuffer
@@ -77,18 +98,128 @@ namespace ncore
             FgIndex      index;
             FgGeneration generation;
         };
-        static const FgBuffer s_invalid_buffer = {0xFFFF};
+        static const FgBuffer s_invalid_buffer = {0xFFFF, 0};
+
+        // A texture that keeps its content from one frame to the next (e.g. TAA history)
+        struct FgHistory
+        {
+            s16 index;
+        };
 
         struct Fg;
 
         typedef callback_t<void, Fg*, GfxRenderContext*> FgExecuteFn;
 
-        Fg*  fg_setup(alloc_t* allocator, u32 resource_capacity, u32 pass_capacity);
+        // The queue a pass is submitted to, passes on different queues may run concurrently on the GPU
+        typedef u8           FgQueue;
+        static const FgQueue FgQueueGraphics = 0;
+        static const FgQueue FgQueueCompute  = 1;
+        static const FgQueue FgQueueCopy     = 2;
+        static const s32     FgQueueCount    = 3;
+
+        // Every queue has a timeline, its value is the number of passes executed on that queue. A sync point
+        // makes a pass wait until 'queue' has reached 'value'.
+        struct FgSyncPoint
+        {
+            FgQueue m_queue;
+            u32     m_value;
+        };
+
+        // Job system interface for fg_execute_parallel, 'dispatch' must run the worker function once for
+        // every worker index in [0, worker_count) concurrently and return when all of them have finished.
+        typedef callback_t<void, s32>             FgWorkerFn;
+        typedef callback_t<void, FgWorkerFn, s32> FgDispatchFn;
+
+        // Memory requirements of a transient resource, filled in by the user
+        struct FgMemoryRequirements
+        {
+            u64 m_size;
+            u64 m_alignment;
+        };
+
+        // Where a transient resource lives in memory, computed by fg_compile when aliasing is enabled.
+        // Transients whose lifetimes do not overlap may be given the same memory.
+        struct FgPlacement
+        {
+            s32 m_heap; // -1 when the resource has not been placed (imported, culled, aliasing disabled or out of heaps)
+            u64 m_offset;
+            u64 m_size;
+        };
+
+        // A state transition of a resource, from the usage of its previous access in the frame to the usage
+        // of this access. 'before' is s_flags_ignored for the first access of a resource in the frame.
+        struct FgTransition
+        {
+            GfxTexture*   m_texture; // nullptr for a buffer transition
+            GfxBuffer*    m_buffer;  // nullptr for a texture transition
+            FgFlags       m_before;
+            FgFlags       m_after;
+            FgSubresource m_range; // the subresources of the texture that transition
+        };
+
+        // How a texture access uses the texture as an attachment, see fg_set_render_pass_merging
+        typedef u8                FgAttachment;
+        static const FgAttachment FgAttachmentNone  = 0; // sampled, storage, copy, ... (not an attachment)
+        static const FgAttachment FgAttachmentWrite = 1; // written as a color or depth/stencil attachment
+        static const FgAttachment FgAttachmentInput = 2; // read as an input attachment (only at the same pixel)
+
+        // A native render pass, consecutive raster passes merged by fg_compile, each pass is a subpass.
+        // The transitions between the subpasses (an attachment that a later subpass reads as an input
+        // attachment) are not issued as barriers, they are the subpass dependencies of the render pass.
+        struct FgRenderPass
+        {
+            FgPass const*       m_passes; // the subpasses in execution order
+            s32                 m_count;
+            FgTransition const* m_dependencies; // the transitions between the subpasses
+            s32                 m_dependency_count;
+        };
+
+        // Load and store ops of a written texture, derived from the lifetime of its versions
+        typedef u8            FgLoadOp;
+        static const FgLoadOp FgLoadOpLoad     = 0; // the previous content is needed
+        static const FgLoadOp FgLoadOpClear    = 1; // no previous content, the pass clears it (fg_clear)
+        static const FgLoadOp FgLoadOpDontCare = 2; // no previous content
+
+        typedef u8             FgStoreOp;
+        static const FgStoreOp FgStoreOpStore    = 0; // the content is used after the (merged render) pass
+        static const FgStoreOp FgStoreOpDontCare = 1; // nobody uses the content after the (merged render) pass
+
+        struct FgAttachmentOps
+        {
+            FgLoadOp  m_load;
+            FgStoreOp m_store;
+        };
+
+        // Statistics of the last compiled graph, and of the last fg_execute (or fg_execute_parallel)
+        struct FgStats
+        {
+            s32 m_pass_count;      // the number of declared passes
+            s32 m_culled_count;    // the number of passes that are culled
+            s32 m_executed_count;  // the number of passes executed
+            s32 m_version_count;   // the number of texture and buffer versions
+            s32 m_physical_count;  // the number of physical textures and buffers, imported ones included
+            s32 m_created_count;   // transients created by fg_execute, not those taken from a pool
+            s32 m_destroyed_count; // transients destroyed after their last pass, not those returned to a pool
+            s32 m_longest_chain;   // the number of passes on the longest chain of dependencies
+            s32 m_peak_live;       // the most transients alive at the same time when executing in order
+            u64 m_peak_live_bytes; // the most memory of the transients alive at the same time (fg_set_memory_texture/buffer)
+            u64 m_compile_ticks;   // the duration of fg_compile, measured with the clock of fg_set_trace
+            u64 m_peak_declared;   // peak transient memory when executing in declaration order (memory schedule)
+            u64 m_peak_scheduled;  // peak transient memory when executing in the scheduled order (memory schedule)
+        };
+
+        // 'pass_data_capacity' is the size in bytes of the frame-linear arena that holds the data of fg_add_pass
+        Fg*  fg_setup(alloc_t* allocator, u32 resource_capacity, u32 pass_capacity, u32 pass_data_capacity = 64 * 1024);
         void fg_teardown(Fg*& fg);
 
+        // Rewind the graph so that the next frame can be declared, all arrays are kept.
+        // Handles from the previous frame become invalid (the resource generation is bumped).
+        void fg_reset(Fg* fg);
+
         void fg_set_create_texture(Fg* fg, callback_t<void, GfxRenderContext*, GfxTexture*, GfxTextureDescr*> fn);
         void fg_set_preread_texture(Fg* fg, callback_t<void, GfxRenderContext*, GfxTexture*, FgFlags> fn);
         void fg_set_prewrite_texture(Fg* fg, callback_t<void, GfxRenderContext*, GfxTexture*, FgFlags> fn);
+        void fg_set_prewrite_texture(Fg* fg, callback_t<void, GfxRenderContext*, GfxTexture*, FgFlags, FgAttachmentOps> fn); // also receives the load/store ops
         void fg_set_destroy_texture(Fg* fg, callback_t<void, GfxRenderContext*, GfxTexture*> fn);
 
         void fg_set_create_buffer(Fg* fg, callback_t<void, GfxRenderContext*, GfxBuffer*, GfxBufferDescr*> fn);
@@ -96,24 +227,221 @@ namespace ncore
         void fg_set_prewrite_buffer(Fg* fg, callback_t<void, GfxRenderContext*, GfxBuffer*, FgFlags> fn);
         void fg_set_destroy_buffer(Fg* fg, callback_t<void, GfxRenderContext*, GfxBuffer*> fn);
 
-        FgPass fg_open_pass(Fg* fg, const char* name, FgExecuteFn execute);
-        FgPass fg_final_pass(Fg* fg, const char* name, FgExecuteFn execute);
-        void   fg_close_pass(Fg* fg);
+        // Batched barriers, the transitions of a pass are computed by fg_compile and delivered as one array
+        // right before the pass is executed. Accesses with ignored flags and a read following a read with the
+        // same flags do not need a transition. When set, the pre-read and pre-write callbacks are not called.
+        void fg_set_transitions(Fg* fg, callback_t<void, GfxRenderContext*, FgTransition const*, s32> fn);
+
+        // Split barriers (requires fg_set_transitions), a transition whose previous access is not in the live pass
+        // right before it begins after the pass of the previous access and ends before the pass that needs it, so
+        // that the GPU can overlap the transition with the passes in between. 'begin' is called after a pass with
+        // the transitions that begin there and 'end' before a pass with the transitions that end there.
+        // fg_execute_parallel issues split transitions as whole transitions before the pass.
+        void fg_set_split_transitions(Fg* fg, callback_t<void, GfxRenderContext*, FgTransition const*, s32> begin, callback_t<void, GfxRenderContext*, FgTransition const*, s32> end);
 
+        // Aliasing of transient resources is enabled by providing a memory requirements query, fg_compile
+        // will then pack the physical transients into one or more heaps (textures and buffers share heaps).
+        // A heap size of 0 means a single heap that grows as large as needed. There are at most 64 heaps, the transients
+        // that do not fit in those are not placed.
+        void fg_set_memory_texture(Fg* fg, callback_t<void, GfxTextureDescr*, FgMemoryRequirements*> fn);
+        void fg_set_memory_buffer(Fg* fg, callback_t<void, GfxBufferDescr*, FgMemoryRequirements*> fn);
+        void fg_set_heap_size(Fg* fg, u64 heap_size);
+
+        // Memory-aware scheduling, fg_compile reorders the passes (within the freedom of their dependencies) to lower
+        // the peak memory of the live transients. The memory requirements queries give the size of a transient.
+        void fg_set_memory_schedule(Fg* fg, bool enable);
+
+        // Culling on bitsets instead of ref-counts, per pass a sparse mask of the versions it reads and of the versions it
+        // produces. One sweep in reverse declaration order keeps the passes whose produce mask intersects the live bits,
+        // with 4, 2 or 1 word at a time (AVX2, SSE2 or scalar, chosen at compile time). Culls the same passes.
+        void fg_set_bitset_culling(Fg* fg, bool enable);
+
+        // Render pass merging (subpass fusion) for tile-based GPUs. A raster pass is a graphics queue pass whose texture
+        // writes are all attachments, 'classify' tells from the FgFlags of an access how it uses the texture. A raster
+        // pass is merged with the raster pass executed right before it when it reads the textures written in that
+        // render pass only as input attachments (or as the attachment it continues to write). 'begin' and 'end' are
+        // called around the passes of a merged render pass by fg_execute, fg_get_subpass tells a pass that it is a
+        // subpass. The backend still has to check that the attachments have the same extent. The waits and the
+        // transitions of all the subpasses are issued before 'begin', the split transitions that begin after the last
+        // subpass and its signal after 'end'. A pass that waits for another queue or has split transitions that end
+        // before it is not merged, nor is a pass after one that signals or begins split transitions.
+        void fg_set_render_pass_merging(Fg* fg, callback_t<FgAttachment, FgFlags> classify, callback_t<void, GfxRenderContext*, FgRenderPass const*> begin, callback_t<void, GfxRenderContext*, FgRenderPass const*> end);
+
+        // Pooling of transient resources across frames, instead of destroying a transient after its last use
+        // it is kept in a pool and handed out again to a transient with an equal descriptor in a following frame.
+        // Entries that have not been used for 'max_unused_frames' frames are destroyed at the end of fg_execute.
+        // Note: the GfxTexture/GfxBuffer objects (and their descriptors) given to fg_create must then outlive
+        // the pool, fg_get returns the pooled object. Call fg_flush_pools before fg_teardown.
+        void fg_set_texture_pool(Fg* fg, u32 capacity, u32 max_unused_frames, callback_t<u64, GfxTextureDescr*> hash, callback_t<bool, GfxTextureDescr*, GfxTextureDescr*> equal);
+        void fg_set_buffer_pool(Fg* fg, u32 capacity, u32 max_unused_frames, callback_t<u64, GfxBufferDescr*> hash, callback_t<bool, GfxBufferDescr*, GfxBufferDescr*> equal);
+        void fg_flush_pools(Fg* fg, GfxRenderContext* ctxt);
+
+        // Cross-queue synchronization, fg_compile derives from the dependencies between passes on different queues
+        // the minimal set of sync points. 'wait' is called before a pass with the sync points it has to wait for,
+        // 'signal' after a pass that another queue waits for, with the value of the pass on its queue timeline.
+        // Transients used by a pass that is not on the graphics queue are kept alive until the end of the frame.
+        void fg_set_queue_sync(Fg* fg, callback_t<void, GfxRenderContext*, FgQueue, FgSyncPoint const*, s32> wait, callback_t<void, GfxRenderContext*, FgQueue, u32> signal);
+
+        // Scratch memory for fg_compile, a region of 'capacity' bytes owned by the graph (allocated from the allocator
+        // given to fg_setup). fg_compile does not allocate then, except for what does not fit in the region, which comes
+        // from the allocator given to fg_compile. fg_get_scratch_peak tells how large the region has to be.
+        void fg_set_scratch(Fg* fg, u32 capacity);
+
+        // Allocation audit, the number of allocations since fg_reset made with the allocator given to fg_setup or to
+        // fg_compile. With a large enough scratch region a frame (fg_reset, declare, fg_compile, fg_execute) makes none.
+        u32 fg_get_allocation_count(Fg* fg);
+        u32 fg_get_scratch_peak(Fg* fg); // the most scratch memory a fg_compile used, including what did not fit
+
+        FgPass  fg_open_pass(Fg* fg, const char* name, FgExecuteFn execute, FgQueue queue = FgQueueGraphics);
+        FgPass  fg_final_pass(Fg* fg, const char* name, FgExecuteFn execute, FgQueue queue = FgQueueGraphics);
+        void    fg_close_pass(Fg* fg);
+        FgQueue fg_get_queue(Fg* fg, FgPass pass);
+        s32     fg_get_subpass(Fg* fg, FgPass pass); // index of the pass in its merged render pass, -1 when not merged
+
+        // Pass data, bump-allocated from the frame-linear arena of the graph that fg_reset rewinds. The memory is zeroed,
+        // 'Data' is neither constructed nor destructed, so it should be plain data (handles, descriptors, pointers).
+        // 'setup' declares the resources of the pass (it is called between open and close), 'execute' is the execute
+        // callback of the pass. Returns the data of the pass, valid until the next fg_reset.
+        void* fg_allocate_pass_data(Fg* fg, u32 size, u32 alignment);
+
+        template <typename Data>
+        struct FgPassData
+        {
+            Data m_data;
+            void (*m_execute)(Fg*, GfxRenderContext*, Data&);
+
+            void execute(Fg* fg, GfxRenderContext* ctxt) { m_execute(fg, ctxt, m_data); }
+        };
+
+        template <typename Data, typename Setup>
+        Data* fg_add_pass(Fg* fg, const char* name, Setup setup, void (*execute)(Fg*, GfxRenderContext*, Data&), FgQueue queue = FgQueueGraphics)
+        {
+            FgPassData<Data>* pass = (FgPassData<Data>*)fg_allocate_pass_data(fg, sizeof(FgPassData<Data>), alignof(FgPassData<Data>));
+            pass->m_execute        = execute;
+            fg_open_pass(fg, name, callback_t(pass, &FgPassData<Data>::execute), queue);
+            setup(fg, pass->m_data);
+            fg_close_pass(fg);
+            return &pass->m_data;
+        }
+
+        template <typename Data, typename Setup>
+        Data* fg_add_final_pass(Fg* fg, const char* name, Setup setup, void (*execute)(Fg*, GfxRenderContext*, Data&), FgQueue queue = FgQueueGraphics)
+        {
+            FgPassData<Data>* pass = (FgPassData<Data>*)fg_allocate_pass_data(fg, sizeof(FgPassData<Data>), alignof(FgPassData<Data>));
+            pass->m_execute        = execute;
+            fg_final_pass(fg, name, callback_t(pass, &FgPassData<Data>::execute), queue);
+            setup(fg, pass->m_data);
+            fg_close_pass(fg);
+            return &pass->m_data;
+        }
+
+        // Imported resources (e.g. the swapchain image) are never created or destroyed by the graph, a pass that
+        // writes an imported resource has side effects and is never culled. Can be called inside or outside a pass.
         FgTexture fg_import(Fg* fg, const char* name, GfxTexture* resource, GfxTextureDescr* descr);
         FgBuffer  fg_import(Fg* fg, const char* name, GfxBuffer* resource, GfxBufferDescr* descr);
 
+        // History textures, a pair of textures that the graph swaps (ping-pong) in fg_reset when the ending frame used
+        // the current texture. The current texture is written by this frame, the previous texture holds what an earlier
+        // frame wrote, both are imported on first use. fg_history_valid is false until a frame used the current texture.
+        FgHistory fg_create_history(Fg* fg, const char* name, GfxTexture* a, GfxTexture* b, GfxTextureDescr* descr);
+        FgTexture fg_history_current(Fg* fg, FgHistory history);
+        FgTexture fg_history_previous(Fg* fg, FgHistory history);
+        bool      fg_history_valid(Fg* fg, FgHistory history);
+
         FgTexture fg_create(Fg* fg, const char* name, GfxTexture* textureObject, GfxTextureDescr* textureDescr);
-        FgTexture fg_read(Fg* fg, FgTexture texture, FgFlags descr = s_flags_ignored);
-        FgTexture fg_write(Fg* fg, FgTexture texture, FgFlags descr = s_flags_ignored);
+        // A read or write of a range of subresources only depends on (and transitions) those subresources, e.g. the passes
+        // that render the cascades into the slices of a shadow map array do not depend on each other. A pass can read and
+        // write the same texture when the ranges do not overlap (e.g. a mip-chain downsample).
+        FgTexture fg_read(Fg* fg, FgTexture texture, FgFlags descr = s_flags_ignored, FgSubresource range = s_subresource_all);
+        FgTexture fg_write(Fg* fg, FgTexture texture, FgFlags descr = s_flags_ignored, FgSubresource range = s_subresource_all);
+        void      fg_clear(Fg* fg, FgTexture texture); // the current pass clears the texture it creates and writes
+
+        // The load and store ops (computed by fg_compile) of the texture version written by a pass, a version that
+        // does not exist yet has nothing to load and a version nobody reads after the render pass does not need a store.
+        FgAttachmentOps fg_get_attachment_ops(Fg* fg, FgTexture texture);
 
         FgBuffer fg_create(Fg* fg, const char* name, GfxBuffer* bufferObject, GfxBufferDescr* bufferDescr);
         FgBuffer fg_read(Fg* fg, FgBuffer buffer, FgFlags descr = s_flags_ignored);
         FgBuffer fg_write(Fg* fg, FgBuffer buffer, FgFlags descr = s_flags_ignored);
 
+        // Multi-threaded declaration, every job declares its passes with its own recorder, into buffers of the recorder
+        // and without locks. fg_merge then declares the recorded passes in the graph, the recorders in the given order and
+        // their passes in recorded order, so that the graph does not depend on the timing of the jobs. A recorder uses the
+        // handles of the graph declared before recording started (e.g. imports) and its own handles. Those are local to
+        // the recorder, fg_resolve turns them into handles of the graph after fg_merge (e.g. in the execute callback).
+        // Recording never reads the graph, handles of the graph are checked by fg_merge.
+        // The pass data of a recorder has to live until the frame is executed, reset the recorders with the graph.
+        struct FgRecorder;
+        FgRecorder* fg_recorder_setup(Fg* fg, u32 op_capacity, u32 pass_capacity, u32 pass_data_capacity = 16 * 1024);
+        void        fg_recorder_teardown(FgRecorder*& recorder);
+        void        fg_recorder_reset(FgRecorder* recorder);
+
+        void      fg_open_pass(FgRecorder* recorder, const char* name, FgExecuteFn execute, FgQueue queue = FgQueueGraphics);
+        void      fg_final_pass(FgRecorder* recorder, const char* name, FgExecuteFn execute, FgQueue queue = FgQueueGraphics);
+        void      fg_close_pass(FgRecorder* recorder);
+        void*     fg_allocate_pass_data(FgRecorder* recorder, u32 size, u32 alignment);
+        FgTexture fg_create(FgRecorder* recorder, const char* name, GfxTexture* textureObject, GfxTextureDescr* textureDescr);
+        FgTexture fg_read(FgRecorder* recorder, FgTexture texture, FgFlags descr = s_flags_ignored, FgSubresource range = s_subresource_all);
+        FgTexture fg_write(FgRecorder* recorder, FgTexture texture, FgFlags descr = s_flags_ignored, FgSubresource range = s_subresource_all);
+        void      fg_clear(FgRecorder* recorder, FgTexture texture);
+        FgBuffer  fg_create(FgRecorder* recorder, const char* name, GfxBuffer* bufferObject, GfxBufferDescr* bufferDescr);
+        FgBuffer  fg_read(FgRecorder* recorder, FgBuffer buffer, FgFlags descr = s_flags_ignored);
+        FgBuffer  fg_write(FgRecorder* recorder, FgBuffer buffer, FgFlags descr = s_flags_ignored);
+
+        void      fg_merge(Fg* fg, FgRecorder** recorders, s32 recorder_count);
+        FgTexture fg_resolve(FgRecorder* recorder, FgTexture texture);
+        FgBuffer  fg_resolve(FgRecorder* recorder, FgBuffer buffer);
+
+        template <typename Data, typename Setup>
+        Data* fg_add_pass(FgRecorder* recorder, const char* name, Setup setup, void (*execute)(Fg*, GfxRenderContext*, Data&), FgQueue queue = FgQueueGraphics)
+        {
+            FgPassData<Data>* pass = (FgPassData<Data>*)fg_allocate_pass_data(recorder, sizeof(FgPassData<Data>), alignof(FgPassData<Data>));
+            pass->m_execute        = execute;
+            fg_open_pass(recorder, name, callback_t(pass, &FgPassData<Data>::execute), queue);
+            setup(recorder, pass->m_data);
+            fg_close_pass(recorder);
+            return &pass->m_data;
+        }
+
+        // fg_compile skips culling, lifetimes, release lists and dependencies when the frame declared the same
+        // passes and accesses (see fg_get_structure_hash) as the last compiled frame. Pools and aliasing are
+        // still updated since the GfxTexture/GfxBuffer objects and their descriptors may differ per frame.
         void fg_compile(Fg* fg, alloc_t* allocator);
         void fg_execute(Fg* fg, GfxRenderContext* ctxt);
 
+        // Records independent passes concurrently, each worker uses its own render context. Pre-read,
+        // pre-write and execute callbacks are called from the workers. Transients are created before and
+        // destroyed after all passes have been recorded, on the calling thread using 'worker_ctxts[0]'.
+        // A merged render pass is recorded as a whole by one worker, between its begin and end callbacks.
+        // A pass that uses an aliased transient starts after the passes that used the transients placed in
+        // the same memory before it (in execution order) have finished.
+        void fg_execute_parallel(Fg* fg, FgDispatchFn dispatch, GfxRenderContext** worker_ctxts, s32 worker_count);
+
+        // Pipelined frames, 'depth' (2 or 3) graphs so that the next frame is declared and compiled on one thread (the
+        // producer) while another thread (the consumer) executes the current frame. Frames are handed over in order through
+        // a lock-free single-producer/single-consumer ring of the graphs, nothing blocks: fg_pipeline_begin returns nullptr
+        // while all graphs are in flight and fg_pipeline_acquire returns nullptr while there is no submitted frame.
+        // Configure every graph (fg_pipeline_graph) before the first frame. Imported resources are declared by every frame,
+        // the transients of frames in flight must not share GfxTexture/GfxBuffer objects (use per-graph objects or pools).
+        struct FgPipeline;
+        FgPipeline* fg_pipeline_setup(alloc_t* allocator, s32 depth, u32 resource_capacity, u32 pass_capacity, u32 pass_data_capacity = 64 * 1024);
+        void        fg_pipeline_teardown(FgPipeline*& pipeline);
+        s32         fg_pipeline_depth(FgPipeline* pipeline);
+        Fg*         fg_pipeline_graph(FgPipeline* pipeline, s32 index);
+
+        // A history texture in every graph of the pipeline, the ping-pong state follows the frames and not the graphs
+        FgHistory fg_pipeline_create_history(FgPipeline* pipeline, const char* name, GfxTexture* a, GfxTexture* b, GfxTextureDescr* descr);
+
+        // Producer, the reset graph to declare the next frame in, fg_pipeline_submit compiles it and hands it over
+        Fg*  fg_pipeline_begin(FgPipeline* pipeline);
+        void fg_pipeline_submit(FgPipeline* pipeline, alloc_t* allocator);
+
+        // Consumer, the graph of the oldest submitted frame to execute, fg_pipeline_release hands it back to the producer
+        Fg*  fg_pipeline_acquire(FgPipeline* pipeline);
+        void fg_pipeline_release(FgPipeline* pipeline);
+
+        bool             fg_is_valid(Fg* fg, FgTexture resource);
+        bool             fg_is_valid(Fg* fg, FgBuffer resource);
         GfxTexture*      fg_get(Fg* fg, FgTexture resource);
         GfxBuffer*       fg_get(Fg* fg, FgBuffer resource);
         GfxTextureDescr* fg_getDescr(Fg* fg, FgTexture resource);
@@ -121,6 +449,39 @@ namespace ncore
         FgFlags          fg_getFlags(Fg* fg, FgTexture resource);
         FgFlags          fg_getFlags(Fg* fg, FgBuffer resource);
 
+        FgPlacement fg_get_placement(Fg* fg, FgTexture resource);
+        FgPlacement fg_get_placement(Fg* fg, FgBuffer resource);
+        s32         fg_get_heap_count(Fg* fg);
+        u64         fg_get_heap_size(Fg* fg, s32 heap);
+        u64         fg_get_structure_hash(Fg* fg); // hash of the passes, their flags and the resource accesses declared so far
+        bool        fg_is_culled(Fg* fg, FgPass pass); // after fg_compile, the pass is not executed
+        void        fg_get_stats(Fg* fg, FgStats* stats);
+
+        // Timeline of fg_compile and fg_execute, scopes around the compile phases and around the create, access
+        // (pre-read/pre-write or transitions), execute and destroy callbacks of every pass. The scopes are written into a
+        // lock-free ring of 'capacity' events that keeps the most recent ones, workers of fg_execute_parallel write into
+        // it concurrently. 'clock' returns a timestamp in ticks, it also times fg_compile (see FgStats) and can be set
+        // with a capacity of 0 for only that. With FG_TRACE set to 0 nothing is recorded and fg_compile is not timed.
+        struct FgTraceEvent
+        {
+            const char* m_name;     // the compile phase or the name of the pass
+            const char* m_category; // "compile", "create", "access", "execute" or "destroy"
+            u64         m_begin;    // ticks
+            u64         m_end;
+            s32         m_thread; // the worker of fg_execute_parallel, 0 otherwise
+        };
+        void fg_set_trace(Fg* fg, u32 capacity, callback_t<u64> clock);
+        s32  fg_get_trace(Fg* fg, FgTraceEvent* events, s32 max_count); // the most recent events, oldest first
+        void fg_clear_trace(Fg* fg);
+
+        // Writes the events as Chrome Trace Event JSON (chrome://tracing, Perfetto) in pieces through 'write'
+        void fg_export_trace(Fg* fg, callback_t<void, const char*, u32> write, u64 ticks_per_us);
+
+        // Writes the compiled graph in pieces through 'write', as Graphviz DOT (passes, versions and their accesses, culled
+        // passes dashed) or as JSON (also the lifetimes, placements, queue waits and the transitions of every pass)
+        void fg_export_dot(Fg* fg, callback_t<void, const char*, u32> write);
+        void fg_export_json(Fg* fg, callback_t<void, const char*, u32> write);
+
     } // namespace nframegraph
 } // namespace ncore
 
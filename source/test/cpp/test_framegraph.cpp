@@ -5,6 +5,9 @@
 
 #include "cunittest/cunittest.h"
 
+#include <atomic>
+#include <thread>
+
 namespace ncore
 {
     using namespace nframegraph;
@@ -530,6 +533,70 @@ UNITTEST_SUITE_BEGIN(framegraph)
             }
         }; // namespace SimplePass
 
+        // A backend that only records what the frame graph asks it to do
+        struct MockBackend
+        {
+            s32 m_textures_created;
+            s32 m_textures_destroyed;
+            s32 m_buffers_created;
+            s32 m_buffers_destroyed;
+            s32 m_executed;
+
+            MockBackend()
+                : m_textures_created(0)
+                , m_textures_destroyed(0)
+                , m_buffers_created(0)
+                , m_buffers_destroyed(0)
+                , m_executed(0)
+            {
+            }
+
+            void createTexture(GfxRenderContext* ctxt, GfxTexture* texture, GfxTextureDescr* descr) { m_textures_created += 1; }
+            void destroyTexture(GfxRenderContext* ctxt, GfxTexture* texture) { m_textures_destroyed += 1; }
+            void createBuffer(GfxRenderContext* ctxt, GfxBuffer* buffer, GfxBufferDescr* descr) { m_buffers_created += 1; }
+            void destroyBuffer(GfxRenderContext* ctxt, GfxBuffer* buffer) { m_buffers_destroyed += 1; }
+            void execute(Fg* fg, GfxRenderContext* ctxt) { m_executed += 1; }
+
+            void attach(Fg* fg)
+            {
+                fg_set_create_texture(fg, callback_t(this, &MockBackend::createTexture));
+                fg_set_destroy_texture(fg, callback_t(this, &MockBackend::destroyTexture));
+                fg_set_create_buffer(fg, callback_t(this, &MockBackend::createBuffer));
+                fg_set_destroy_buffer(fg, callback_t(this, &MockBackend::destroyBuffer));
+            }
+
+            FgExecuteFn pass() { return callback_t(this, &MockBackend::execute); }
+
+            static void memoryTexture(GfxTextureDescr* descr, FgMemoryRequirements* req)
+            {
+                req->m_size      = (u64)descr->width * descr->height * 4;
+                req->m_alignment = 256;
+            }
+
+            static u64  hashTexture(GfxTextureDescr* descr) { return ((u64)descr->width << 16) | descr->height; }
+            static bool equalTexture(GfxTextureDescr* a, GfxTextureDescr* b) { return a->width == b->width && a->height == b->height; }
+        };
+
+        // Records the order in which passes are executed
+        struct OrderedPass
+        {
+            s32* m_cursor;
+            s32  m_order;
+
+            void execute(Fg* fg, GfxRenderContext* ctxt)
+            {
+                m_order = (*m_cursor)++;
+                ctxt->ref_count += 1;
+            }
+        };
+
+        // A job system that runs the workers one after the other
+        static void dispatchSerial(FgWorkerFn worker, s32 worker_count)
+        {
+            for (s32 i = 0; i < worker_count; ++i)
+                worker.Call(i);
+        }
+
         UNITTEST_TEST(SimpleExample)
         {
             GfxRenderContext ctxt;
@@ -559,5 +626,2010 @@ UNITTEST_SUITE_BEGIN(framegraph)
             }
             fg_teardown(fg);
         }
+
+        UNITTEST_TEST(ResetAndReuse)
+        {
+            GfxRenderContext ctxt;
+
+            Fg* fg = fg_setup(&alloc, 256, 64);
+            {
+                fg_set_create_texture(fg, callback_t<void, GfxRenderContext*, GfxTexture*, GfxTextureDescr*>(createTexture));
+                fg_set_destroy_texture(fg, callback_t<void, GfxRenderContext*, GfxTexture*>(destroyTexture));
+
+                SimplePass simplePass(1280, 720);
+                FgTexture  previous = s_invalid_texture;
+                for (s32 frame = 0; frame < 3; ++frame)
+                {
+                    fg_reset(fg);
+                    CHECK_FALSE(fg_is_valid(fg, previous));
+
+                    simplePass.pass = fg_final_pass(fg, "SimplePass", callback_t(&simplePass, &SimplePass::execute));
+                    {
+                        simplePass.out_RT = fg_create(fg, "SimplePassOutput", &simplePass.targetTexture, &simplePass.targetTextureDescr);
+                        fg_write(fg, simplePass.out_RT);
+                    }
+                    fg_close_pass(fg);
+                    CHECK_TRUE(fg_is_valid(fg, simplePass.out_RT));
+
+                    fg_compile(fg, &alloc);
+                    fg_execute(fg, &ctxt);
+
+                    previous = simplePass.out_RT;
+                }
+
+                CHECK_EQUAL(3, simplePass.m_executed);
+            }
+            fg_teardown(fg);
+        }
+
+        UNITTEST_TEST(ReleaseLists)
+        {
+            GfxRenderContext ctxt;
+            MockBackend      backend;
+
+            GfxTexture      textures[3];
+            GfxTextureDescr descrs[3];
+            GfxBuffer       buffer;
+            GfxBufferDescr  bufferDescr;
+
+            Fg* fg = fg_setup(&alloc, 256, 64);
+            {
+                backend.attach(fg);
+
+                // A creates 'a' and 'b', B modifies 'a' (new version), C (culled) reads 'b', D (final) reads 'a'
+                fg_open_pass(fg, "A", backend.pass());
+                FgTexture a = fg_write(fg, fg_create(fg, "a", &textures[0], &descrs[0]));
+                FgTexture b = fg_write(fg, fg_create(fg, "b", &textures[1], &descrs[1]));
+                FgBuffer  u = fg_write(fg, fg_create(fg, "u", &buffer, &bufferDescr));
+                fg_close_pass(fg);
+
+                fg_open_pass(fg, "B", backend.pass());
+                a = fg_write(fg, a);
+                fg_read(fg, u);
+                fg_close_pass(fg);
+
+                fg_open_pass(fg, "C", backend.pass());
+                fg_read(fg, b);
+                fg_write(fg, fg_create(fg, "c", &textures[2], &descrs[2]));
+                fg_close_pass(fg);
+
+                fg_final_pass(fg, "D", backend.pass());
+                fg_read(fg, a);
+                fg_close_pass(fg);
+
+                fg_compile(fg, &alloc);
+                fg_execute(fg, &ctxt);
+
+                CHECK_EQUAL(3, backend.m_executed);
+                CHECK_EQUAL(2, backend.m_textures_created);
+                CHECK_EQUAL(2, backend.m_textures_destroyed);
+                CHECK_EQUAL(1, backend.m_buffers_created);
+                CHECK_EQUAL(1, backend.m_buffers_destroyed);
+            }
+            fg_teardown(fg);
+        }
+
+        UNITTEST_TEST(CachedCompile)
+        {
+            GfxRenderContext ctxt;
+            MockBackend      backend;
+
+            GfxTexture      textures[2];
+            GfxTextureDescr descrs[2];
+
+            Fg* fg = fg_setup(&alloc, 256, 64);
+            {
+                backend.attach(fg);
+
+                // A creates 'a' and 'b', B (culled unless final) reads 'b', C (final) reads 'a'
+                u64 hashes[3];
+                for (s32 frame = 0; frame < 3; ++frame)
+                {
+                    fg_reset(fg);
+                    fg_open_pass(fg, "A", backend.pass());
+                    FgTexture a = fg_write(fg, fg_create(fg, "a", &textures[0], &descrs[0]));
+                    FgTexture b = fg_write(fg, fg_create(fg, "b", &textures[1], &descrs[1]));
+                    fg_close_pass(fg);
+
+                    if (frame < 2)
+                        fg_open_pass(fg, "B", backend.pass());
+                    else
+                        fg_final_pass(fg, "B", backend.pass());
+                    fg_read(fg, b);
+                    fg_close_pass(fg);
+
+                    fg_final_pass(fg, "C", backend.pass());
+                    fg_read(fg, a);
+                    fg_close_pass(fg);
+
+                    hashes[frame] = fg_get_structure_hash(fg);
+                    fg_compile(fg, &alloc);
+                    fg_execute(fg, &ctxt);
+                }
+
+                CHECK_TRUE(hashes[0] == hashes[1]);
+                CHECK_TRUE(hashes[1] != hashes[2]);
+                CHECK_EQUAL(2 + 2 + 3, backend.m_executed);
+                CHECK_EQUAL(2 + 2 + 2, backend.m_textures_created);
+                CHECK_EQUAL(2 + 2 + 2, backend.m_textures_destroyed);
+            }
+            fg_teardown(fg);
+        }
+
+        struct TransitionRecorder
+        {
+            s32          m_calls;
+            s32          m_count;
+            FgTransition m_log[16];
+
+            void record(GfxRenderContext* ctxt, FgTransition const* transitions, s32 count)
+            {
+                m_calls += 1;
+                for (s32 i = 0; i < count && m_count < 16; ++i)
+                    m_log[m_count++] = transitions[i];
+            }
+        };
+
+        UNITTEST_TEST(BatchedTransitions)
+        {
+            GfxRenderContext   ctxt;
+            MockBackend        backend;
+            TransitionRecorder recorder = {0, 0};
+
+            GfxTexture      texture;
+            GfxTextureDescr descr;
+
+            FgFlags const write  = {1};
+            FgFlags const sample = {2};
+            FgFlags const copy   = {3};
+
+            Fg* fg = fg_setup(&alloc, 256, 64);
+            {
+                backend.attach(fg);
+                fg_set_transitions(fg, callback_t(&recorder, &TransitionRecorder::record));
+
+                // B and C read with the same usage, C does not need a transition
+                fg_open_pass(fg, "A", backend.pass());
+                FgTexture t = fg_write(fg, fg_create(fg, "t", &texture, &descr), write);
+                fg_close_pass(fg);
+                fg_final_pass(fg, "B", backend.pass());
+                fg_read(fg, t, sample);
+                fg_close_pass(fg);
+                fg_final_pass(fg, "C", backend.pass());
+                fg_read(fg, t, sample);
+                fg_close_pass(fg);
+                fg_final_pass(fg, "D", backend.pass());
+                fg_read(fg, t, copy);
+                fg_close_pass(fg);
+
+                fg_compile(fg, &alloc);
+                fg_execute(fg, &ctxt);
+
+                CHECK_EQUAL(4, backend.m_executed);
+                CHECK_EQUAL(3, recorder.m_calls);
+                CHECK_EQUAL(3, recorder.m_count);
+                CHECK_TRUE(recorder.m_log[0].m_texture == &texture && recorder.m_log[0].m_buffer == nullptr);
+                CHECK_TRUE(fg_flags_ignored(recorder.m_log[0].m_before));
+                CHECK_EQUAL(write.m_descr, recorder.m_log[0].m_after.m_descr);
+                CHECK_EQUAL(write.m_descr, recorder.m_log[1].m_before.m_descr);
+                CHECK_EQUAL(sample.m_descr, recorder.m_log[1].m_after.m_descr);
+                CHECK_EQUAL(sample.m_descr, recorder.m_log[2].m_before.m_descr);
+                CHECK_EQUAL(copy.m_descr, recorder.m_log[2].m_after.m_descr);
+            }
+            fg_teardown(fg);
+        }
+
+        UNITTEST_TEST(SplitTransitions)
+        {
+            GfxRenderContext   ctxt;
+            MockBackend        backend;
+            TransitionRecorder whole = {0, 0};
+            TransitionRecorder begin = {0, 0};
+            TransitionRecorder end   = {0, 0};
+
+            GfxTexture      textures[2];
+            GfxTextureDescr descrs[2];
+
+            FgFlags const write  = {1};
+            FgFlags const sample = {2};
+
+            Fg* fg = fg_setup(&alloc, 256, 64);
+            {
+                backend.attach(fg);
+                fg_set_transitions(fg, callback_t(&whole, &TransitionRecorder::record));
+                fg_set_split_transitions(fg, callback_t(&begin, &TransitionRecorder::record), callback_t(&end, &TransitionRecorder::record));
+
+                // 't' is written by A and read by C with B in between, its transition is split
+                fg_open_pass(fg, "A", backend.pass());
+                FgTexture t = fg_write(fg, fg_create(fg, "t", &textures[0], &descrs[0]), write);
+                fg_close_pass(fg);
+                fg_open_pass(fg, "B", backend.pass());
+                FgTexture u = fg_write(fg, fg_create(fg, "u", &textures[1], &descrs[1]), write);
+                fg_close_pass(fg);
+                fg_final_pass(fg, "C", backend.pass());
+                fg_read(fg, t, sample);
+                fg_read(fg, u, sample);
+                fg_close_pass(fg);
+
+                fg_compile(fg, &alloc);
+                fg_execute(fg, &ctxt);
+
+                CHECK_EQUAL(3, backend.m_executed);
+                CHECK_EQUAL(3, whole.m_count);
+                CHECK_EQUAL(1, begin.m_calls);
+                CHECK_EQUAL(1, end.m_calls);
+                CHECK_TRUE(begin.m_log[0].m_texture == &textures[0]);
+                CHECK_TRUE(end.m_log[0].m_texture == &textures[0]);
+                CHECK_EQUAL(write.m_descr, end.m_log[0].m_before.m_descr);
+                CHECK_EQUAL(sample.m_descr, end.m_log[0].m_after.m_descr);
+                CHECK_TRUE(whole.m_log[2].m_texture == &textures[1]);
+            }
+            fg_teardown(fg);
+        }
+
+        UNITTEST_TEST(TransientAliasing)
+        {
+            MockBackend backend;
+
+            GfxTexture      textures[3];
+            GfxTextureDescr descrs[3];
+            for (s32 i = 0; i < 3; ++i)
+            {
+                descrs[i].width  = 16;
+                descrs[i].height = 16;
+            }
+
+            Fg* fg = fg_setup(&alloc, 256, 64);
+            {
+                backend.attach(fg);
+                fg_set_memory_texture(fg, callback_t<void, GfxTextureDescr*, FgMemoryRequirements*>(MockBackend::memoryTexture));
+
+                // A chain where 't0' and 't2' are never alive at the same time
+                FgTexture t[3];
+                fg_open_pass(fg, "A", backend.pass());
+                t[0] = fg_write(fg, fg_create(fg, "t0", &textures[0], &descrs[0]));
+                fg_close_pass(fg);
+                fg_open_pass(fg, "B", backend.pass());
+                fg_read(fg, t[0]);
+                t[1] = fg_write(fg, fg_create(fg, "t1", &textures[1], &descrs[1]));
+                fg_close_pass(fg);
+                fg_open_pass(fg, "C", backend.pass());
+                fg_read(fg, t[1]);
+                t[2] = fg_write(fg, fg_create(fg, "t2", &textures[2], &descrs[2]));
+                fg_close_pass(fg);
+                fg_final_pass(fg, "D", backend.pass());
+                fg_read(fg, t[2]);
+                fg_close_pass(fg);
+
+                fg_compile(fg, &alloc);
+
+                FgPlacement p0 = fg_get_placement(fg, t[0]);
+                FgPlacement p1 = fg_get_placement(fg, t[1]);
+                FgPlacement p2 = fg_get_placement(fg, t[2]);
+                CHECK_EQUAL(1, fg_get_heap_count(fg));
+                CHECK_EQUAL(0, p0.m_heap);
+                CHECK_EQUAL(0, p0.m_offset);
+                CHECK_EQUAL(1024, p1.m_offset);
+                CHECK_EQUAL(0, p2.m_offset);
+                CHECK_EQUAL(2048, fg_get_heap_size(fg, 0));
+
+                // Heaps that can only hold one of them
+                fg_set_heap_size(fg, 1024);
+                fg_compile(fg, &alloc);
+                CHECK_EQUAL(2, fg_get_heap_count(fg));
+                CHECK_EQUAL(fg_get_placement(fg, t[0]).m_heap, fg_get_placement(fg, t[2]).m_heap);
+                CHECK_NOT_EQUAL(fg_get_placement(fg, t[0]).m_heap, fg_get_placement(fg, t[1]).m_heap);
+            }
+            fg_teardown(fg);
+        }
+
+        UNITTEST_TEST(ParallelExecute)
+        {
+            MockBackend      backend;
+            GfxRenderContext ctxts[2];
+            ctxts[0].ref_count             = 0;
+            ctxts[1].ref_count             = 0;
+            GfxRenderContext* worker_ctxts[] = {&ctxts[0], &ctxts[1]};
+
+            GfxTexture      textures[3];
+            GfxTextureDescr descrs[3];
+
+            s32         cursor = 0;
+            OrderedPass passes[5];
+            for (s32 i = 0; i < 5; ++i)
+                passes[i] = {&cursor, -1};
+
+            Fg* fg = fg_setup(&alloc, 256, 64);
+            {
+                backend.attach(fg);
+
+                // 'Shadow' and 'GBuffer' are independent, 'Lighting' depends on both, 'Unused' is culled
+                fg_open_pass(fg, "Shadow", callback_t(&passes[0], &OrderedPass::execute));
+                FgTexture shadow = fg_write(fg, fg_create(fg, "shadow", &textures[0], &descrs[0]));
+                fg_close_pass(fg);
+                fg_open_pass(fg, "GBuffer", callback_t(&passes[1], &OrderedPass::execute));
+                FgTexture gbuffer = fg_write(fg, fg_create(fg, "gbuffer", &textures[1], &descrs[1]));
+                fg_close_pass(fg);
+                fg_open_pass(fg, "Unused", callback_t(&passes[2], &OrderedPass::execute));
+                fg_read(fg, gbuffer);
+                fg_write(fg, fg_create(fg, "unused", &textures[2], &descrs[2]));
+                fg_close_pass(fg);
+                fg_open_pass(fg, "Lighting", callback_t(&passes[3], &OrderedPass::execute));
+                fg_read(fg, shadow);
+                gbuffer = fg_write(fg, gbuffer);
+                fg_close_pass(fg);
+                fg_final_pass(fg, "Present", callback_t(&passes[4], &OrderedPass::execute));
+                fg_read(fg, gbuffer);
+                fg_close_pass(fg);
+
+                fg_compile(fg, &alloc);
+                fg_execute_parallel(fg, FgDispatchFn(dispatchSerial), worker_ctxts, 2);
+
+                CHECK_EQUAL(4, cursor);
+                CHECK_EQUAL(-1, passes[2].m_order);
+                CHECK_TRUE(passes[3].m_order > passes[0].m_order);
+                CHECK_TRUE(passes[3].m_order > passes[1].m_order);
+                CHECK_TRUE(passes[4].m_order > passes[3].m_order);
+                CHECK_EQUAL(4, ctxts[0].ref_count + ctxts[1].ref_count);
+                CHECK_EQUAL(2, backend.m_textures_created);
+                CHECK_EQUAL(2, backend.m_textures_destroyed);
+            }
+            fg_teardown(fg);
+        }
+
+        UNITTEST_TEST(TransientPool)
+        {
+            GfxRenderContext ctxt;
+            MockBackend      backend;
+
+            GfxTexture      textures[2];
+            GfxTextureDescr descrs[2];
+
+            Fg* fg = fg_setup(&alloc, 256, 64);
+            {
+                backend.attach(fg);
+                fg_set_texture_pool(fg, 8, 2, callback_t<u64, GfxTextureDescr*>(MockBackend::hashTexture), callback_t<bool, GfxTextureDescr*, GfxTextureDescr*>(MockBackend::equalTexture));
+
+                for (s32 frame = 0; frame < 4; ++frame)
+                {
+                    fg_reset(fg);
+                    fg_open_pass(fg, "A", backend.pass());
+                    FgTexture t = fg_write(fg, fg_create(fg, "t", &textures[frame & 1], &descrs[frame & 1]));
+                    fg_close_pass(fg);
+                    fg_final_pass(fg, "B", backend.pass());
+                    fg_read(fg, t);
+                    fg_close_pass(fg);
+
+                    fg_compile(fg, &alloc);
+                    CHECK_TRUE(fg_get(fg, t) == &textures[0]);
+                    fg_execute(fg, &ctxt);
+                }
+                CHECK_EQUAL(1, backend.m_textures_created);
+                CHECK_EQUAL(0, backend.m_textures_destroyed);
+
+                // A frame that is compiled but not executed hands the pooled texture back in fg_reset
+                for (s32 frame = 0; frame < 2; ++frame)
+                {
+                    fg_reset(fg);
+                    fg_open_pass(fg, "A", backend.pass());
+                    FgTexture t = fg_write(fg, fg_create(fg, "t", &textures[1], &descrs[1]));
+                    fg_close_pass(fg);
+                    fg_final_pass(fg, "B", backend.pass());
+                    fg_read(fg, t);
+                    fg_close_pass(fg);
+
+                    fg_compile(fg, &alloc);
+                    CHECK_TRUE(fg_get(fg, t) == &textures[0]);
+                    if (frame == 1)
+                        fg_execute(fg, &ctxt);
+                }
+                CHECK_EQUAL(1, backend.m_textures_created);
+                CHECK_EQUAL(0, backend.m_textures_destroyed);
+
+                // Frames that do not use the texture, it is evicted after 2 unused frames
+                for (s32 frame = 0; frame < 2; ++frame)
+                {
+                    fg_reset(fg);
+                    fg_compile(fg, &alloc);
+                    fg_execute(fg, &ctxt);
+                }
+                CHECK_EQUAL(1, backend.m_textures_destroyed);
+
+                fg_flush_pools(fg, &ctxt);
+                CHECK_EQUAL(1, backend.m_textures_destroyed);
+            }
+            fg_teardown(fg);
+        }
+
+        // Records the cross-queue sync points
+        struct QueueRecorder
+        {
+            s32 m_waits;
+            s32 m_signals;
+            u32 m_wait_log[8]; // (pass queue << 16) | (sync queue << 8) | value
+            u32 m_signal_log[8];
+
+            void wait(GfxRenderContext* ctxt, FgQueue queue, FgSyncPoint const* points, s32 count)
+            {
+                for (s32 i = 0; i < count && m_waits < 8; ++i)
+                    m_wait_log[m_waits++] = ((u32)queue << 16) | ((u32)points[i].m_queue << 8) | points[i].m_value;
+            }
+            void signal(GfxRenderContext* ctxt, FgQueue queue, u32 value)
+            {
+                if (m_signals < 8)
+                    m_signal_log[m_signals++] = ((u32)queue << 8) | value;
+            }
+        };
+
+        UNITTEST_TEST(AsyncCompute)
+        {
+            GfxRenderContext ctxt;
+            MockBackend      backend;
+            QueueRecorder    recorder = {0, 0};
+
+            GfxTexture      textures[5];
+            GfxTextureDescr descrs[5];
+            for (s32 i = 0; i < 5; ++i)
+            {
+                descrs[i].width  = 16;
+                descrs[i].height = 16;
+            }
+
+            Fg* fg = fg_setup(&alloc, 256, 64);
+            {
+                backend.attach(fg);
+                fg_set_memory_texture(fg, callback_t<void, GfxTextureDescr*, FgMemoryRequirements*>(MockBackend::memoryTexture));
+                fg_set_queue_sync(fg, callback_t(&recorder, &QueueRecorder::wait), callback_t(&recorder, &QueueRecorder::signal));
+
+                // SSAO and light culling run on the compute queue, overlapping the shadow pass
+                fg_open_pass(fg, "Depth", backend.pass());
+                FgTexture depth = fg_write(fg, fg_create(fg, "depth", &textures[0], &descrs[0]));
+                fg_close_pass(fg);
+                fg_open_pass(fg, "Shadow", backend.pass());
+                FgTexture shadow = fg_write(fg, fg_create(fg, "shadow", &textures[1], &descrs[1]));
+                fg_close_pass(fg);
+                FgPass ssao = fg_open_pass(fg, "SSAO", backend.pass(), FgQueueCompute);
+                fg_read(fg, depth);
+                FgTexture ao = fg_write(fg, fg_create(fg, "ao", &textures[2], &descrs[2]));
+                fg_close_pass(fg);
+                fg_open_pass(fg, "LightCull", backend.pass(), FgQueueCompute);
+                fg_read(fg, depth);
+                FgTexture lights = fg_write(fg, fg_create(fg, "lights", &textures[3], &descrs[3]));
+                fg_close_pass(fg);
+                fg_open_pass(fg, "Sky", backend.pass());
+                FgTexture sky = fg_write(fg, fg_create(fg, "sky", &textures[4], &descrs[4]));
+                fg_close_pass(fg);
+                fg_final_pass(fg, "Lighting", backend.pass());
+                fg_read(fg, shadow);
+                fg_read(fg, ao);
+                fg_read(fg, lights);
+                fg_read(fg, sky);
+                fg_close_pass(fg);
+
+                fg_compile(fg, &alloc);
+                fg_execute(fg, &ctxt);
+
+                CHECK_EQUAL(FgQueueCompute, fg_get_queue(fg, ssao));
+                CHECK_EQUAL(6, backend.m_executed);
+
+                // SSAO waits for Depth, LightCull already knows about it, Lighting only waits for LightCull
+                CHECK_EQUAL(2, recorder.m_waits);
+                CHECK_EQUAL((FgQueueCompute << 16) | (FgQueueGraphics << 8) | 1, recorder.m_wait_log[0]);
+                CHECK_EQUAL((FgQueueGraphics << 16) | (FgQueueCompute << 8) | 2, recorder.m_wait_log[1]);
+                CHECK_EQUAL(2, recorder.m_signals);
+                CHECK_EQUAL((FgQueueGraphics << 8) | 1, recorder.m_signal_log[0]);
+                CHECK_EQUAL((FgQueueCompute << 8) | 2, recorder.m_signal_log[1]);
+
+                // 'depth' is last used on the compute queue, it must not share memory with 'sky'
+                FgPlacement const d = fg_get_placement(fg, depth);
+                FgPlacement const s = fg_get_placement(fg, sky);
+                CHECK_TRUE(d.m_heap != s.m_heap || d.m_offset + d.m_size <= s.m_offset || s.m_offset + s.m_size <= d.m_offset);
+            }
+            fg_teardown(fg);
+        }
+
+        UNITTEST_TEST(MemorySchedule)
+        {
+            MockBackend      backend;
+            GfxRenderContext ctxt;
+            ctxt.ref_count = 0;
+
+            GfxTexture      textures[4];
+            GfxTextureDescr descrs[4];
+            for (s32 i = 0; i < 4; ++i)
+            {
+                descrs[i].width  = i < 2 ? 64 : 4;
+                descrs[i].height = i < 2 ? 64 : 4;
+            }
+
+            s32         cursor = 0;
+            OrderedPass passes[5];
+            for (s32 i = 0; i < 5; ++i)
+                passes[i] = {&cursor, -1};
+
+            Fg* fg = fg_setup(&alloc, 256, 64);
+            {
+                backend.attach(fg);
+                fg_set_memory_texture(fg, callback_t<void, GfxTextureDescr*, FgMemoryRequirements*>(MockBackend::memoryTexture));
+                fg_set_memory_schedule(fg, true);
+
+                // Declared as A, B, C, D: 'x' and 'y' (16 KB each) are alive at the same time, running C
+                // before B releases 'x' before 'y' is created.
+                fg_open_pass(fg, "A", callback_t(&passes[0], &OrderedPass::execute));
+                FgTexture x = fg_write(fg, fg_create(fg, "x", &textures[0], &descrs[0]));
+                fg_close_pass(fg);
+                fg_open_pass(fg, "B", callback_t(&passes[1], &OrderedPass::execute));
+                FgTexture y = fg_write(fg, fg_create(fg, "y", &textures[1], &descrs[1]));
+                fg_close_pass(fg);
+                fg_open_pass(fg, "C", callback_t(&passes[2], &OrderedPass::execute));
+                fg_read(fg, x);
+                FgTexture u = fg_write(fg, fg_create(fg, "u", &textures[2], &descrs[2]));
+                fg_close_pass(fg);
+                fg_open_pass(fg, "D", callback_t(&passes[3], &OrderedPass::execute));
+                fg_read(fg, y);
+                FgTexture v = fg_write(fg, fg_create(fg, "v", &textures[3], &descrs[3]));
+                fg_close_pass(fg);
+                fg_final_pass(fg, "E", callback_t(&passes[4], &OrderedPass::execute));
+                fg_read(fg, u);
+                fg_read(fg, v);
+                fg_close_pass(fg);
+
+                fg_compile(fg, &alloc);
+                fg_execute(fg, &ctxt);
+
+                CHECK_EQUAL(0, passes[0].m_order);
+                CHECK_EQUAL(1, passes[2].m_order);
+                CHECK_EQUAL(2, passes[1].m_order);
+                CHECK_EQUAL(3, passes[3].m_order);
+                CHECK_EQUAL(4, passes[4].m_order);
+                CHECK_EQUAL(4, backend.m_textures_created);
+                CHECK_EQUAL(4, backend.m_textures_destroyed);
+
+                FgStats stats;
+                fg_get_stats(fg, &stats);
+                CHECK_EQUAL(5, stats.m_pass_count);
+                CHECK_EQUAL(0, stats.m_culled_count);
+                CHECK_EQUAL(2 * 16384 + 64, stats.m_peak_declared);
+                CHECK_EQUAL(16384 + 2 * 64, stats.m_peak_scheduled);
+
+                // 'x' and 'y' are no longer alive at the same time and can share memory
+                CHECK_EQUAL(fg_get_placement(fg, x).m_offset, fg_get_placement(fg, y).m_offset);
+            }
+            fg_teardown(fg);
+        }
+
+        struct RenderPassRecorder
+        {
+            s32    m_begins;
+            s32    m_ends;
+            s32    m_count;
+            FgPass m_first;
+
+            static FgAttachment classify(FgFlags flags) { return flags.m_descr == 1 ? FgAttachmentWrite : (flags.m_descr == 2 ? FgAttachmentInput : FgAttachmentNone); }
+
+            void begin(GfxRenderContext* ctxt, FgRenderPass const* render_pass)
+            {
+                m_begins += 1;
+                m_count = render_pass->m_count;
+                m_first = render_pass->m_passes[0];
+            }
+            void end(GfxRenderContext* ctxt, FgRenderPass const* render_pass) { m_ends += (render_pass->m_passes[0] == m_first) ? 1 : 0; }
+        };
+
+        UNITTEST_TEST(RenderPassMerging)
+        {
+            MockBackend        backend;
+            GfxRenderContext   ctxt;
+            RenderPassRecorder recorder = {0, 0, 0, nullptr};
+            ctxt.ref_count              = 0;
+
+            GfxTexture      textures[4];
+            GfxTextureDescr descrs[4];
+
+            FgFlags const attachment = {1};
+            FgFlags const input      = {2};
+            FgFlags const sample     = {3};
+
+            s32         cursor = 0;
+            OrderedPass passes[3];
+            for (s32 i = 0; i < 3; ++i)
+                passes[i] = {&cursor, -1};
+
+            Fg* fg = fg_setup(&alloc, 256, 64);
+            {
+                backend.attach(fg);
+                fg_set_render_pass_merging(fg, callback_t<FgAttachment, FgFlags>(RenderPassRecorder::classify), callback_t(&recorder, &RenderPassRecorder::begin), callback_t(&recorder, &RenderPassRecorder::end));
+
+                // Lighting reads the GBuffer as input attachments and becomes its second subpass, Post samples
+                // the HDR target and has to start a render pass of its own.
+                FgPass    gbuffer = fg_open_pass(fg, "GBuffer", callback_t(&passes[0], &OrderedPass::execute));
+                FgTexture albedo  = fg_write(fg, fg_create(fg, "albedo", &textures[0], &descrs[0]), attachment);
+                FgTexture normal  = fg_write(fg, fg_create(fg, "normal", &textures[1], &descrs[1]), attachment);
+                fg_close_pass(fg);
+                FgPass lighting = fg_open_pass(fg, "Lighting", callback_t(&passes[1], &OrderedPass::execute));
+                fg_read(fg, albedo, input);
+                fg_read(fg, normal, input);
+                FgTexture hdr = fg_write(fg, fg_create(fg, "hdr", &textures[2], &descrs[2]), attachment);
+                fg_close_pass(fg);
+                FgPass post = fg_final_pass(fg, "Post", callback_t(&passes[2], &OrderedPass::execute));
+                fg_read(fg, hdr, sample);
+                fg_write(fg, fg_create(fg, "ldr", &textures[3], &descrs[3]), attachment);
+                fg_close_pass(fg);
+
+                fg_compile(fg, &alloc);
+                fg_execute(fg, &ctxt);
+
+                CHECK_EQUAL(0, fg_get_subpass(fg, gbuffer));
+                CHECK_EQUAL(1, fg_get_subpass(fg, lighting));
+                CHECK_EQUAL(-1, fg_get_subpass(fg, post));
+                CHECK_EQUAL(1, recorder.m_begins);
+                CHECK_EQUAL(1, recorder.m_ends);
+                CHECK_EQUAL(2, recorder.m_count);
+                CHECK_TRUE(recorder.m_first == gbuffer);
+
+                CHECK_EQUAL(0, passes[0].m_order);
+                CHECK_EQUAL(1, passes[1].m_order);
+                CHECK_EQUAL(2, passes[2].m_order);
+                CHECK_EQUAL(4, backend.m_textures_created);
+                CHECK_EQUAL(4, backend.m_textures_destroyed);
+
+                // The workers record the merged render pass as a whole, in one context
+                GfxRenderContext  ctxts[2];
+                GfxRenderContext* worker_ctxts[] = {&ctxts[0], &ctxts[1]};
+                ctxts[0].ref_count               = 0;
+                ctxts[1].ref_count               = 0;
+                cursor                           = 0;
+                fg_execute_parallel(fg, FgDispatchFn(dispatchSerial), worker_ctxts, 2);
+                CHECK_EQUAL(2, recorder.m_begins);
+                CHECK_EQUAL(2, recorder.m_ends);
+                CHECK_EQUAL(0, passes[0].m_order);
+                CHECK_EQUAL(1, passes[1].m_order);
+                CHECK_EQUAL(2, passes[2].m_order);
+                CHECK_TRUE(ctxts[0].ref_count >= 2 || ctxts[1].ref_count >= 2);
+            }
+            fg_teardown(fg);
+        }
+
+        // The order of the barriers, queue operations and render pass callbacks of a frame
+        struct RenderPassLog
+        {
+            s32 m_count;
+            s32 m_events[16];
+            s32 m_dependencies;
+
+            static const s32 c_begin   = 1;
+            static const s32 c_end     = 2;
+            static const s32 c_execute = 3;
+            static const s32 c_wait    = 4;
+            static const s32 c_signal  = 5;
+
+            void log(s32 event)
+            {
+                if (m_count < 16)
+                    m_events[m_count] = event;
+                m_count += 1;
+            }
+
+            void transitions(GfxRenderContext* ctxt, FgTransition const* transitions, s32 count) { log(100 + count); }
+            void begin(GfxRenderContext* ctxt, FgRenderPass const* render_pass)
+            {
+                m_dependencies = render_pass->m_dependency_count;
+                log(c_begin);
+            }
+            void end(GfxRenderContext* ctxt, FgRenderPass const* render_pass) { log(c_end); }
+            void execute(Fg* fg, GfxRenderContext* ctxt) { log(c_execute); }
+            void wait(GfxRenderContext* ctxt, FgQueue queue, FgSyncPoint const* points, s32 count) { log(c_wait); }
+            void signal(GfxRenderContext* ctxt, FgQueue queue, u32 value) { log(c_signal); }
+        };
+
+        UNITTEST_TEST(RenderPassBarriers)
+        {
+            MockBackend      backend;
+            GfxRenderContext ctxt;
+            RenderPassLog    log = {0, {0}, 0};
+
+            GfxTexture      textures[5];
+            GfxTextureDescr descrs[5];
+
+            FgFlags const attachment = {1};
+            FgFlags const input      = {2};
+            FgFlags const sample     = {3};
+
+            u32 const      region_size = 1 * cMB;
+            void*          graph_mem   = Allocator->allocate(region_size);
+            linear_alloc_t graph_alloc;
+            graph_alloc.setup(graph_mem, region_size);
+
+            Fg* fg = fg_setup(&graph_alloc, 64, 64);
+            {
+                backend.attach(fg);
+                fg_set_transitions(fg, callback_t(&log, &RenderPassLog::transitions));
+                fg_set_render_pass_merging(fg, callback_t<FgAttachment, FgFlags>(RenderPassRecorder::classify), callback_t(&log, &RenderPassLog::begin), callback_t(&log, &RenderPassLog::end));
+                fg_set_queue_sync(fg, callback_t(&log, &RenderPassLog::wait), callback_t(&log, &RenderPassLog::signal));
+
+                // Lighting is a subpass of GBuffer, the creation of 'hdr' is issued before the render pass begins and the
+                // input attachment reads of the GBuffer are subpass dependencies
+                fg_open_pass(fg, "GBuffer", callback_t(&log, &RenderPassLog::execute));
+                FgTexture albedo = fg_write(fg, fg_create(fg, "albedo", &textures[0], &descrs[0]), attachment);
+                FgTexture normal = fg_write(fg, fg_create(fg, "normal", &textures[1], &descrs[1]), attachment);
+                fg_close_pass(fg);
+                FgPass lighting = fg_open_pass(fg, "Lighting", callback_t(&log, &RenderPassLog::execute));
+                fg_read(fg, albedo, input);
+                fg_read(fg, normal, input);
+                FgTexture hdr = fg_write(fg, fg_create(fg, "hdr", &textures[2], &descrs[2]), attachment);
+                fg_close_pass(fg);
+                fg_final_pass(fg, "Post", callback_t(&log, &RenderPassLog::execute));
+                fg_read(fg, hdr, sample);
+                fg_write(fg, fg_create(fg, "ldr", &textures[3], &descrs[3]), attachment);
+                fg_close_pass(fg);
+
+                fg_compile(fg, &graph_alloc);
+                fg_execute(fg, &ctxt);
+
+                CHECK_EQUAL(1, fg_get_subpass(fg, lighting));
+                s32 const expected[] = {102, 101, RenderPassLog::c_begin, RenderPassLog::c_execute, RenderPassLog::c_execute, RenderPassLog::c_end, 102, RenderPassLog::c_execute};
+                CHECK_EQUAL(8, log.m_count);
+                for (s32 i = 0; i < 8; ++i)
+                    CHECK_EQUAL(expected[i], log.m_events[i]);
+                CHECK_EQUAL(2, log.m_dependencies);
+
+                // A pass that waits for the compute queue does not become a subpass
+                fg_reset(fg);
+                log.m_count = 0;
+                fg_open_pass(fg, "Cull", callback_t(&log, &RenderPassLog::execute), FgQueueCompute);
+                FgTexture mask = fg_write(fg, fg_create(fg, "mask", &textures[4], &descrs[4]));
+                fg_close_pass(fg);
+                fg_open_pass(fg, "GBuffer", callback_t(&log, &RenderPassLog::execute));
+                albedo = fg_write(fg, fg_create(fg, "albedo", &textures[0], &descrs[0]), attachment);
+                fg_close_pass(fg);
+                lighting = fg_final_pass(fg, "Lighting", callback_t(&log, &RenderPassLog::execute));
+                fg_read(fg, albedo, input);
+                fg_read(fg, mask, sample);
+                fg_write(fg, fg_create(fg, "hdr", &textures[2], &descrs[2]), attachment);
+                fg_close_pass(fg);
+
+                fg_compile(fg, &graph_alloc);
+                fg_execute(fg, &ctxt);
+
+                CHECK_EQUAL(-1, fg_get_subpass(fg, lighting));
+                for (s32 i = 0; i < log.m_count && i < 16; ++i)
+                {
+                    CHECK_NOT_EQUAL(RenderPassLog::c_begin, log.m_events[i]);
+                    CHECK_NOT_EQUAL(RenderPassLog::c_end, log.m_events[i]);
+                }
+            }
+            fg_teardown(fg);
+            Allocator->deallocate(graph_mem);
+        }
+
+        struct AttachmentOpsRecorder
+        {
+            s32             m_count;
+            FgAttachmentOps m_log[8];
+
+            void prewrite(GfxRenderContext* ctxt, GfxTexture* texture, FgFlags flags, FgAttachmentOps ops)
+            {
+                if (m_count < 8)
+                    m_log[m_count] = ops;
+                m_count += 1;
+            }
+        };
+
+        UNITTEST_TEST(AttachmentOps)
+        {
+            MockBackend           backend;
+            GfxRenderContext      ctxt;
+            AttachmentOpsRecorder recorder = {0};
+            ctxt.ref_count                 = 0;
+
+            GfxTexture      textures[4];
+            GfxTextureDescr descrs[4];
+
+            FgFlags const attachment = {1};
+            FgFlags const sample     = {3};
+
+            Fg* fg = fg_setup(&alloc, 256, 64);
+            {
+                backend.attach(fg);
+                fg_set_prewrite_texture(fg, callback_t(&recorder, &AttachmentOpsRecorder::prewrite));
+
+                // 'depth' is cleared by A and continued by B, nobody needs it after B
+                fg_open_pass(fg, "A", backend.pass());
+                FgTexture color = fg_write(fg, fg_create(fg, "color", &textures[0], &descrs[0]), attachment);
+                FgTexture depth = fg_write(fg, fg_create(fg, "depth", &textures[1], &descrs[1]), attachment);
+                fg_clear(fg, depth);
+                fg_close_pass(fg);
+                fg_open_pass(fg, "B", backend.pass());
+                fg_read(fg, color, sample);
+                FgTexture depth2 = fg_write(fg, depth, attachment);
+                FgTexture hdr    = fg_write(fg, fg_create(fg, "hdr", &textures[2], &descrs[2]), attachment);
+                fg_close_pass(fg);
+                fg_final_pass(fg, "C", backend.pass());
+                fg_read(fg, hdr, sample);
+                FgTexture ldr = fg_write(fg, fg_create(fg, "ldr", &textures[3], &descrs[3]), attachment);
+                fg_close_pass(fg);
+
+                fg_compile(fg, &alloc);
+                fg_execute(fg, &ctxt);
+
+                CHECK_EQUAL(FgLoadOpDontCare, fg_get_attachment_ops(fg, color).m_load);
+                CHECK_EQUAL(FgStoreOpStore, fg_get_attachment_ops(fg, color).m_store);
+                CHECK_EQUAL(FgLoadOpClear, fg_get_attachment_ops(fg, depth).m_load);
+                CHECK_EQUAL(FgStoreOpStore, fg_get_attachment_ops(fg, depth).m_store);
+                CHECK_EQUAL(FgLoadOpLoad, fg_get_attachment_ops(fg, depth2).m_load);
+                CHECK_EQUAL(FgStoreOpDontCare, fg_get_attachment_ops(fg, depth2).m_store);
+                CHECK_EQUAL(FgStoreOpStore, fg_get_attachment_ops(fg, hdr).m_store);
+                CHECK_EQUAL(FgStoreOpStore, fg_get_attachment_ops(fg, ldr).m_store);
+
+                // Delivered together with the pre-write of every attachment, in execution order
+                CHECK_EQUAL(5, recorder.m_count);
+                CHECK_EQUAL(FgLoadOpClear, recorder.m_log[1].m_load);
+                CHECK_EQUAL(FgStoreOpDontCare, recorder.m_log[2].m_store);
+            }
+            fg_teardown(fg);
+        }
+
+        UNITTEST_TEST(ImportedResources)
+        {
+            MockBackend      backend;
+            GfxRenderContext ctxt;
+            ctxt.ref_count = 0;
+
+            GfxTexture      backbuffer, scratch;
+            GfxTextureDescr backbufferDescr, scratchDescr;
+
+            s32         cursor = 0;
+            OrderedPass passes[2];
+            for (s32 i = 0; i < 2; ++i)
+                passes[i] = {&cursor, -1};
+
+            Fg* fg = fg_setup(&alloc, 256, 64);
+            {
+                backend.attach(fg);
+
+                // Nobody reads what 'Present' and 'Unused' write, only the write to the import keeps a pass alive
+                FgTexture swapchain = fg_import(fg, "swapchain", &backbuffer, &backbufferDescr);
+                fg_open_pass(fg, "Present", callback_t(&passes[0], &OrderedPass::execute));
+                FgTexture presented = fg_write(fg, swapchain);
+                fg_close_pass(fg);
+                fg_open_pass(fg, "Unused", callback_t(&passes[1], &OrderedPass::execute));
+                fg_write(fg, fg_create(fg, "scratch", &scratch, &scratchDescr));
+                fg_close_pass(fg);
+
+                fg_compile(fg, &alloc);
+                fg_execute(fg, &ctxt);
+
+                CHECK_EQUAL(0, passes[0].m_order);
+                CHECK_EQUAL(-1, passes[1].m_order);
+                CHECK_EQUAL(0, backend.m_textures_created);
+                CHECK_EQUAL(0, backend.m_textures_destroyed);
+                CHECK_TRUE(fg_get(fg, presented) == &backbuffer);
+                CHECK_EQUAL(FgStoreOpStore, fg_get_attachment_ops(fg, presented).m_store);
+            }
+            fg_teardown(fg);
+        }
+
+        UNITTEST_TEST(HistoryTextures)
+        {
+            MockBackend      backend;
+            GfxRenderContext ctxt;
+            ctxt.ref_count = 0;
+
+            GfxTexture      history[2];
+            GfxTextureDescr historyDescr;
+
+            Fg* fg = fg_setup(&alloc, 256, 64);
+            {
+                backend.attach(fg);
+                FgHistory taa = fg_create_history(fg, "taa", &history[0], &history[1], &historyDescr);
+
+                for (s32 frame = 0; frame < 3; ++frame)
+                {
+                    fg_reset(fg);
+                    CHECK_EQUAL(frame > 0, fg_history_valid(fg, taa));
+
+                    fg_open_pass(fg, "TAA", backend.pass());
+                    if (fg_history_valid(fg, taa))
+                        fg_read(fg, fg_history_previous(fg, taa));
+                    FgTexture current = fg_write(fg, fg_history_current(fg, taa));
+                    fg_close_pass(fg);
+
+                    fg_compile(fg, &alloc);
+                    fg_execute(fg, &ctxt);
+
+                    // The textures swap every frame, what this frame writes is read by the next one
+                    CHECK_TRUE(fg_get(fg, current) == &history[frame & 1]);
+                    CHECK_TRUE(fg_get(fg, fg_history_previous(fg, taa)) == &history[(frame + 1) & 1]);
+                }
+
+                CHECK_EQUAL(3, backend.m_executed);
+                CHECK_EQUAL(0, backend.m_textures_created);
+                CHECK_EQUAL(0, backend.m_textures_destroyed);
+            }
+            fg_teardown(fg);
+        }
+
+        UNITTEST_TEST(SubresourceTracking)
+        {
+            GfxRenderContext   ctxt;
+            MockBackend        backend;
+            QueueRecorder      queues      = {0, 0};
+            TransitionRecorder transitions = {0, 0};
+
+            GfxTexture      textures[2];
+            GfxTextureDescr descrs[2];
+
+            FgFlags const write  = {1};
+            FgFlags const sample = {2};
+
+            Fg* fg = fg_setup(&alloc, 256, 64);
+            {
+                backend.attach(fg);
+                fg_set_queue_sync(fg, callback_t(&queues, &QueueRecorder::wait), callback_t(&queues, &QueueRecorder::signal));
+                fg_set_transitions(fg, callback_t(&transitions, &TransitionRecorder::record));
+
+                // The cascades write their own slice, 'Cascade1' does not depend on 'Cascade0'
+                fg_open_pass(fg, "Clear", backend.pass());
+                FgTexture shadow = fg_write(fg, fg_create(fg, "shadow", &textures[0], &descrs[0]), write);
+                fg_close_pass(fg);
+                fg_open_pass(fg, "Cascade0", backend.pass());
+                shadow = fg_write(fg, shadow, write, fg_slices(0));
+                fg_close_pass(fg);
+                fg_open_pass(fg, "Cascade1", backend.pass(), FgQueueCompute);
+                shadow = fg_write(fg, shadow, write, fg_slices(1));
+                fg_close_pass(fg);
+
+                // A downsample pass reads one mip and writes the next one of the same texture
+                fg_open_pass(fg, "Bloom", backend.pass());
+                FgTexture bloom = fg_write(fg, fg_create(fg, "bloom", &textures[1], &descrs[1]), write, fg_mips(0));
+                fg_close_pass(fg);
+                fg_open_pass(fg, "Downsample", backend.pass());
+                fg_read(fg, bloom, sample, fg_mips(0));
+                bloom = fg_write(fg, bloom, write, fg_mips(1));
+                fg_close_pass(fg);
+
+                fg_final_pass(fg, "Lighting", backend.pass());
+                fg_read(fg, shadow, sample);
+                fg_read(fg, bloom, sample, fg_mips(1));
+                fg_close_pass(fg);
+
+                fg_compile(fg, &alloc);
+                fg_execute(fg, &ctxt);
+                CHECK_EQUAL(6, backend.m_executed);
+
+                // Cascade1 only waits for Clear (the first graphics pass), not for Cascade0
+                CHECK_EQUAL(2, queues.m_waits);
+                CHECK_EQUAL((FgQueueCompute << 16) | (FgQueueGraphics << 8) | 1, queues.m_wait_log[0]);
+                CHECK_EQUAL((FgQueueGraphics << 16) | (FgQueueCompute << 8) | 1, queues.m_wait_log[1]);
+
+                // Clear, Cascade0 and Cascade1 transition their slices
+                CHECK_EQUAL(10, transitions.m_count);
+                CHECK_EQUAL(0xFFFF, transitions.m_log[0].m_range.m_slice_count);
+                CHECK_EQUAL(0, transitions.m_log[1].m_range.m_slice);
+                CHECK_EQUAL(1, transitions.m_log[1].m_range.m_slice_count);
+                CHECK_EQUAL(1, transitions.m_log[2].m_range.m_slice);
+                CHECK_EQUAL(1, transitions.m_log[2].m_range.m_slice_count);
+
+                // Bloom writes mip 0, Downsample reads mip 0 and writes mip 1
+                CHECK_EQUAL(0, transitions.m_log[3].m_range.m_mip);
+                CHECK_EQUAL(1, transitions.m_log[3].m_range.m_mip_count);
+                CHECK_EQUAL(sample.m_descr, transitions.m_log[4].m_after.m_descr);
+                CHECK_EQUAL(0, transitions.m_log[4].m_range.m_mip);
+                CHECK_EQUAL(write.m_descr, transitions.m_log[5].m_after.m_descr);
+                CHECK_EQUAL(1, transitions.m_log[5].m_range.m_mip);
+                CHECK_TRUE(fg_flags_ignored(transitions.m_log[5].m_before));
+
+                // Lighting reads mip 1 of 'bloom' and the three slice ranges of 'shadow', these transitions follow since
+                // their previous access is not in the pass right before Lighting (split transitions)
+                CHECK_EQUAL(1, transitions.m_log[6].m_range.m_mip);
+                u32 slices = 0;
+                for (s32 i = 7; i < 10; ++i)
+                {
+                    CHECK_EQUAL(sample.m_descr, transitions.m_log[i].m_after.m_descr);
+                    slices += transitions.m_log[i].m_range.m_slice_count;
+                }
+                CHECK_EQUAL(0xFFFF, slices);
+            }
+            fg_teardown(fg);
+        }
+
+        struct BlurData
+        {
+            FgTexture       m_input;
+            FgTexture       m_output;
+            GfxTexture      m_texture;
+            GfxTextureDescr m_descr;
+            s32*            m_executed;
+        };
+
+        static void executeBlur(Fg* fg, GfxRenderContext* ctxt, BlurData& data) { *data.m_executed += fg_get(fg, data.m_output) == &data.m_texture ? 1 : 0; }
+
+        UNITTEST_TEST(PassDataArena)
+        {
+            MockBackend      backend;
+            GfxRenderContext ctxt;
+            s32              executed = 0;
+
+            Fg* fg = fg_setup(&alloc, 256, 64, 4096);
+            {
+                backend.attach(fg);
+
+                BlurData* first = nullptr;
+                for (s32 frame = 0; frame < 2; ++frame)
+                {
+                    fg_reset(fg);
+
+                    // The pass data lives in the arena of the graph, the passes keep their handles in it
+                    BlurData* horizontal = fg_add_pass<BlurData>(fg, "BlurH",
+                                                                 [&executed](Fg* fg, BlurData& data) {
+                                                                     data.m_executed = &executed;
+                                                                     data.m_output   = fg_write(fg, fg_create(fg, "h", &data.m_texture, &data.m_descr));
+                                                                 },
+                                                                 executeBlur);
+                    BlurData* vertical = fg_add_final_pass<BlurData>(fg, "BlurV",
+                                                                     [&executed, horizontal](Fg* fg, BlurData& data) {
+                                                                         data.m_executed = &executed;
+                                                                         data.m_input    = fg_read(fg, horizontal->m_output);
+                                                                         data.m_output   = fg_write(fg, fg_create(fg, "v", &data.m_texture, &data.m_descr));
+                                                                     },
+                                                                     executeBlur);
+
+                    fg_compile(fg, &alloc);
+                    fg_execute(fg, &ctxt);
+
+                    // Contiguous, and rewound by fg_reset
+                    CHECK_TRUE((u8*)vertical > (u8*)horizontal);
+                    if (frame == 0)
+                        first = horizontal;
+                    CHECK_TRUE(first == horizontal);
+                }
+
+                CHECK_EQUAL(4, executed);
+                CHECK_EQUAL(4, backend.m_textures_created);
+            }
+            fg_teardown(fg);
+        }
+
+        // A random graph, textures and buffers that are created, read and written, imported textures and buffers (side
+        // effects when written), read-only passes, final passes (one in 'final_rate'), and textures that are created in
+        // one pass and written in a later one
+        static void s_random_graph(Fg* fg, MockBackend& backend, u64 seed, FgPass* passes, s32 pass_count, GfxTexture* textures, GfxTextureDescr* descrs, GfxBuffer* buffers, GfxBufferDescr* bufferDescrs, u32 final_rate, s32 imported_textures, s32 imported_buffers)
+        {
+            FgTexture t[16];
+            FgBuffer  b[8];
+            s32       t_count = 0;
+            s32       b_count = 0;
+            for (s32 i = 0; i < imported_textures; ++i)
+                t[t_count++] = fg_import(fg, "imported", &textures[i], &descrs[i]);
+            for (s32 i = 0; i < imported_buffers; ++i)
+                b[b_count++] = fg_import(fg, "imported", &buffers[i], &bufferDescrs[i]);
+
+            for (s32 i = 0; i < pass_count; ++i)
+            {
+                seed         = seed * 6364136223846793005ull + 1442695040888963407ull;
+                u32 const r  = (u32)(seed >> 33);
+                bool const f = (r % final_rate) == 0;
+                passes[i]    = f ? fg_final_pass(fg, "P", backend.pass()) : fg_open_pass(fg, "P", backend.pass());
+
+                // Read one texture and maybe a buffer, write another texture and maybe a buffer, the slots differ
+                s32 const read  = (s32)((r >> 4) % t_count);
+                s32 const write = (s32)((r >> 9) % t_count);
+                fg_read(fg, t[read]);
+                if (write != read && ((r >> 14) & 3) != 0)
+                    t[write] = fg_write(fg, t[write]);
+                if (b_count > 0 && ((r >> 16) & 1) != 0)
+                    fg_read(fg, b[(r >> 17) % b_count]);
+                else if (b_count > 0 && ((r >> 16) & 3) == 2)
+                    b[(r >> 17) % b_count] = fg_write(fg, b[(r >> 17) % b_count]);
+
+                // New resources, now and then a texture that is left for a later pass to write
+                if (((r >> 20) & 3) == 0 && t_count < 16)
+                {
+                    FgTexture const c = fg_create(fg, "t", &textures[t_count], &descrs[t_count]);
+                    t[t_count++]      = ((r >> 22) & 3) == 0 ? c : fg_write(fg, c);
+                }
+                if (((r >> 24) & 7) == 0 && b_count < 8)
+                {
+                    b[b_count] = fg_write(fg, fg_create(fg, "b", &buffers[b_count], &bufferDescrs[b_count]));
+                    b_count++;
+                }
+                fg_close_pass(fg);
+            }
+        }
+
+        UNITTEST_TEST(BitsetCulling)
+        {
+            GfxTexture      textures[16];
+            GfxTextureDescr descrs[16];
+            GfxBuffer       buffers[8];
+            GfxBufferDescr  bufferDescrs[8];
+
+            MockBackend backend;
+            Fg*         fgs[2];
+            for (s32 g = 0; g < 2; ++g)
+            {
+                fgs[g] = fg_setup(&alloc, 256, 128);
+                fg_set_bitset_culling(fgs[g], g == 1);
+            }
+
+            // The compile scratch memory is rewound for every graph
+            u32 const      scratch_size = 1 * cMB;
+            void*          scratch_mem  = alloc.allocate(scratch_size);
+            linear_alloc_t scratch;
+
+            // The same random graphs culled with ref-counts and with bitsets, then graphs where a third of the passes
+            // is final and many write imported textures and buffers (side effects)
+            for (s32 anchored = 0; anchored < 2; ++anchored)
+            {
+                s32 culled = 0;
+                for (u64 seed = 1; seed <= 64; ++seed)
+                {
+                    FgPass  passes[2][96];
+                    FgStats stats[2];
+                    for (s32 g = 0; g < 2; ++g)
+                    {
+                        scratch.setup(scratch_mem, scratch_size);
+                        fg_reset(fgs[g]);
+                        if (anchored == 0)
+                            s_random_graph(fgs[g], backend, seed, passes[g], 96, textures, descrs, buffers, bufferDescrs, 23, 2, 0);
+                        else
+                            s_random_graph(fgs[g], backend, seed, passes[g], 96, textures, descrs, buffers, bufferDescrs, 3, 6, 4);
+                        fg_compile(fgs[g], &scratch);
+                        fg_get_stats(fgs[g], &stats[g]);
+                    }
+
+                    CHECK_EQUAL(stats[0].m_culled_count, stats[1].m_culled_count);
+                    for (s32 i = 0; i < 96; ++i)
+                        CHECK_EQUAL(fg_is_culled(fgs[0], passes[0][i]), fg_is_culled(fgs[1], passes[1][i]));
+                    culled += stats[0].m_culled_count;
+                }
+
+                // The graphs do cull passes, and keep others
+                CHECK_TRUE(culled > 0 && culled < 64 * 96);
+            }
+
+            fg_teardown(fgs[1]);
+            fg_teardown(fgs[0]);
+        }
+
+        UNITTEST_TEST(AllocationAudit)
+        {
+            GfxRenderContext ctxt;
+            GfxTexture       textures[16];
+            GfxTextureDescr  descrs[16];
+            GfxBuffer        buffers[8];
+            GfxBufferDescr   bufferDescrs[8];
+            FgPass           passes[64];
+
+            // The graph (and its scratch region) and the compile memory each have their own allocator
+            u32 const      region_size = 2 * cMB;
+            void*          graph_mem   = Allocator->allocate(region_size);
+            void*          compile_mem = Allocator->allocate(region_size);
+            linear_alloc_t graph_alloc;
+            linear_alloc_t compile_alloc;
+            graph_alloc.setup(graph_mem, region_size);
+            compile_alloc.setup(compile_mem, region_size);
+
+            MockBackend backend;
+            Fg*         fg = fg_setup(&graph_alloc, 256, 128);
+            backend.attach(fg);
+            fg_set_memory_texture(fg, callback_t<void, GfxTextureDescr*, FgMemoryRequirements*>(MockBackend::memoryTexture));
+            for (s32 i = 0; i < 16; ++i)
+            {
+                descrs[i].width  = 64 << (i & 3);
+                descrs[i].height = 64;
+            }
+
+            // Without a scratch region the compile of a new structure allocates
+            fg_reset(fg);
+            s_random_graph(fg, backend, 1, passes, 64, textures, descrs, buffers, bufferDescrs, 23, 2, 0);
+            fg_compile(fg, &compile_alloc);
+            fg_execute(fg, &ctxt);
+            CHECK_TRUE(fg_get_allocation_count(fg) > 0);
+
+            // Warm-up frame, the scratch region is allocated once
+            fg_set_scratch(fg, 256 * 1024);
+            fg_reset(fg);
+            s_random_graph(fg, backend, 2, passes, 64, textures, descrs, buffers, bufferDescrs, 23, 2, 0);
+            fg_compile(fg, &compile_alloc);
+            fg_execute(fg, &ctxt);
+
+            // Every frame has a different structure, culling, lifetimes and aliasing are computed again
+            for (u64 seed = 3; seed < 35; ++seed)
+            {
+                fg_reset(fg);
+                s_random_graph(fg, backend, seed, passes, 64, textures, descrs, buffers, bufferDescrs, 23, 2, 0);
+                fg_compile(fg, &compile_alloc);
+                fg_execute(fg, &ctxt);
+                CHECK_EQUAL(0, fg_get_allocation_count(fg));
+            }
+            CHECK_TRUE(fg_get_scratch_peak(fg) > 0 && fg_get_scratch_peak(fg) <= 256 * 1024);
+
+            // A region that is too small falls back to the allocator of fg_compile, the audit reports it
+            fg_set_scratch(fg, 64);
+            fg_reset(fg);
+            s_random_graph(fg, backend, 35, passes, 64, textures, descrs, buffers, bufferDescrs, 23, 2, 0);
+            fg_compile(fg, &compile_alloc);
+            CHECK_TRUE(fg_get_allocation_count(fg) > 0);
+            CHECK_TRUE(fg_get_scratch_peak(fg) > 64);
+
+            fg_teardown(fg);
+            Allocator->deallocate(compile_mem);
+            Allocator->deallocate(graph_mem);
+        }
+
+        UNITTEST_TEST(Pipeline)
+        {
+            MockBackend      backend;
+            GfxRenderContext ctxt;
+            ctxt.ref_count = 0;
+
+            GfxTexture      history[2];
+            GfxTextureDescr historyDescr;
+
+            u32 const      region_size = 2 * cMB;
+            void*          graph_mem   = Allocator->allocate(region_size);
+            void*          compile_mem = Allocator->allocate(region_size);
+            linear_alloc_t graph_alloc;
+            linear_alloc_t compile_alloc;
+            graph_alloc.setup(graph_mem, region_size);
+            compile_alloc.setup(compile_mem, region_size);
+
+            FgPipeline* pipeline = fg_pipeline_setup(&graph_alloc, 2, 256, 64);
+            for (s32 i = 0; i < fg_pipeline_depth(pipeline); ++i)
+                backend.attach(fg_pipeline_graph(pipeline, i));
+            FgHistory taa = fg_pipeline_create_history(pipeline, "taa", &history[0], &history[1], &historyDescr);
+
+            // The producer runs ahead of the consumer as far as the graphs allow
+            FgTexture written[6];
+            s32       declared = 0;
+            s32       executed = 0;
+            while (executed < 6)
+            {
+                Fg* fg;
+                while (declared < 6 && (fg = fg_pipeline_begin(pipeline)) != nullptr)
+                {
+                    // The history state follows the frames, each graph only sees every other frame
+                    CHECK_EQUAL(declared > 0, fg_history_valid(fg, taa));
+
+                    fg_open_pass(fg, "TAA", backend.pass());
+                    if (fg_history_valid(fg, taa))
+                        fg_read(fg, fg_history_previous(fg, taa));
+                    written[declared] = fg_write(fg, fg_history_current(fg, taa));
+                    fg_close_pass(fg);
+
+                    fg_pipeline_submit(pipeline, &compile_alloc);
+                    declared++;
+                }
+                CHECK_TRUE(declared == 6 || declared - executed == 2);
+
+                fg = fg_pipeline_acquire(pipeline);
+                CHECK_TRUE(fg != nullptr);
+                fg_execute(fg, &ctxt);
+                CHECK_TRUE(fg_get(fg, written[executed]) == &history[executed & 1]);
+                fg_pipeline_release(pipeline);
+                executed++;
+            }
+            CHECK_TRUE(fg_pipeline_acquire(pipeline) == nullptr);
+            CHECK_EQUAL(6, backend.m_executed);
+
+            fg_pipeline_teardown(pipeline);
+            Allocator->deallocate(compile_mem);
+            Allocator->deallocate(graph_mem);
+        }
+
+        struct ShadowData
+        {
+            FgRecorder*     m_recorder; // the handles are those of the recorder, nullptr when declared in the graph
+            FgTexture       m_map;
+            GfxTexture      m_texture;
+            GfxTextureDescr m_descr;
+            s32*            m_executed;
+        };
+
+        static void executeShadow(Fg* fg, GfxRenderContext* ctxt, ShadowData& data)
+        {
+            FgTexture map = data.m_recorder != nullptr ? fg_resolve(data.m_recorder, data.m_map) : data.m_map;
+            *data.m_executed += fg_get(fg, map) == &data.m_texture ? 1 : 0;
+        }
+
+        // Declares the same passes in a graph or in a recorder, 'Debug' is culled
+        template <typename Target>
+        static FgBuffer s_declare_particles(Target* target, MockBackend& backend, GfxBuffer* buffer, GfxBufferDescr* bufferDescr, GfxTexture* texture, GfxTextureDescr* textureDescr)
+        {
+            fg_open_pass(target, "Simulate", backend.pass());
+            FgBuffer particles = fg_write(target, fg_create(target, "particles", buffer, bufferDescr));
+            fg_close_pass(target);
+
+            fg_open_pass(target, "Debug", backend.pass());
+            fg_read(target, particles);
+            fg_write(target, fg_create(target, "debug", texture, textureDescr));
+            fg_close_pass(target);
+            return particles;
+        }
+
+        UNITTEST_TEST(RecordedDeclaration)
+        {
+            MockBackend      backend;
+            GfxRenderContext ctxt;
+            s32              executed = 0;
+
+            GfxTexture      backbuffer;
+            GfxTextureDescr backbufferDescr;
+            GfxTexture      debug;
+            GfxTextureDescr debugDescr;
+            GfxBuffer       buffer;
+            GfxBufferDescr  bufferDescr;
+
+            u32 const      region_size = 2 * cMB;
+            void*          graph_mem   = Allocator->allocate(region_size);
+            linear_alloc_t graph_alloc;
+            graph_alloc.setup(graph_mem, region_size);
+
+            // Graph 0 is declared directly, graph 1 by two recorders (e.g. the jobs of two feature systems)
+            Fg* graphs[2];
+            for (s32 g = 0; g < 2; ++g)
+            {
+                graphs[g] = fg_setup(&graph_alloc, 256, 64, 4096);
+                backend.attach(graphs[g]);
+            }
+            FgRecorder* shadows   = fg_recorder_setup(graphs[1], 64, 8, 1024);
+            FgRecorder* particles = fg_recorder_setup(graphs[1], 64, 8);
+
+            for (s32 frame = 0; frame < 2; ++frame)
+            {
+                fg_reset(graphs[0]);
+                fg_reset(graphs[1]);
+                fg_recorder_reset(shadows);
+                fg_recorder_reset(particles);
+
+                Fg*         fg     = graphs[0];
+                FgTexture   output = fg_import(fg, "backbuffer", &backbuffer, &backbufferDescr);
+                ShadowData* shadow = fg_add_pass<ShadowData>(fg, "Shadow",
+                                                             [&executed](Fg* fg, ShadowData& data) {
+                                                                 data.m_executed = &executed;
+                                                                 data.m_map      = fg_write(fg, fg_create(fg, "shadow", &data.m_texture, &data.m_descr));
+                                                             },
+                                                             executeShadow);
+                FgBuffer    simulated = s_declare_particles(fg, backend, &buffer, &bufferDescr, &debug, &debugDescr);
+                fg_final_pass(fg, "Lighting", backend.pass());
+                fg_read(fg, shadow->m_map);
+                fg_read(fg, simulated);
+                fg_write(fg, output);
+                fg_close_pass(fg);
+
+                // The recorders use a handle of the graph ('output') and their own, the particles are recorded first
+                fg                   = graphs[1];
+                output               = fg_import(fg, "backbuffer", &backbuffer, &backbufferDescr);
+                simulated            = s_declare_particles(particles, backend, &buffer, &bufferDescr, &debug, &debugDescr);
+                ShadowData* recorded = fg_add_pass<ShadowData>(shadows, "Shadow",
+                                                               [&executed](FgRecorder* recorder, ShadowData& data) {
+                                                                   data.m_recorder = recorder;
+                                                                   data.m_executed = &executed;
+                                                                   data.m_map      = fg_write(recorder, fg_create(recorder, "shadow", &data.m_texture, &data.m_descr));
+                                                               },
+                                                               executeShadow);
+
+                // Merged in a fixed order, the graph is the same as the one declared directly
+                FgRecorder* recorders[2] = {shadows, particles};
+                fg_merge(fg, recorders, 2);
+                fg_final_pass(fg, "Lighting", backend.pass());
+                fg_read(fg, fg_resolve(shadows, recorded->m_map));
+                fg_read(fg, fg_resolve(particles, simulated));
+                fg_write(fg, output);
+                fg_close_pass(fg);
+
+                CHECK_EQUAL(fg_get_structure_hash(graphs[0]), fg_get_structure_hash(graphs[1]));
+
+                for (s32 g = 0; g < 2; ++g)
+                {
+                    FgStats stats;
+                    fg_compile(graphs[g], &graph_alloc);
+                    fg_execute(graphs[g], &ctxt);
+                    fg_get_stats(graphs[g], &stats);
+                    CHECK_EQUAL(4, stats.m_pass_count);
+                    CHECK_EQUAL(1, stats.m_culled_count);
+                }
+            }
+
+            CHECK_EQUAL(4, executed);
+            CHECK_EQUAL(8, backend.m_executed);
+
+            fg_recorder_teardown(particles);
+            fg_recorder_teardown(shadows);
+            fg_teardown(graphs[1]);
+            fg_teardown(graphs[0]);
+            Allocator->deallocate(graph_mem);
+        }
+
+        // A clock that advances 10 ticks every time it is read
+        struct TraceClock
+        {
+            u64 m_ticks;
+            u64 now() { return m_ticks += 10; }
+        };
+
+        // Collects the output of an export
+        struct TextOutput
+        {
+            char m_text[4096];
+            u32  m_size;
+
+            void write(const char* text, u32 size)
+            {
+                for (u32 i = 0; i < size && m_size < sizeof(m_text) - 1; ++i)
+                    m_text[m_size++] = text[i];
+                m_text[m_size] = 0;
+            }
+
+            static bool equal(const char* a, const char* b)
+            {
+                while (*a != 0 && *a == *b)
+                    ++a, ++b;
+                return *a == *b;
+            }
+
+            bool contains(const char* str) const
+            {
+                for (u32 i = 0; i < m_size; ++i)
+                {
+                    u32 j = 0;
+                    while (str[j] != 0 && i + j < m_size && m_text[i + j] == str[j])
+                        ++j;
+                    if (str[j] == 0)
+                        return true;
+                }
+                return false;
+            }
+        };
+
+        UNITTEST_TEST(TraceExport)
+        {
+            MockBackend      backend;
+            GfxRenderContext ctxt;
+            TraceClock       clock = {0};
+            TextOutput       output;
+            output.m_size = 0;
+
+            GfxTexture      textures[2];
+            GfxTextureDescr descrs[2];
+
+            u32 const      region_size = 1 * cMB;
+            void*          graph_mem   = Allocator->allocate(region_size);
+            linear_alloc_t graph_alloc;
+            graph_alloc.setup(graph_mem, region_size);
+
+            Fg* fg = fg_setup(&graph_alloc, 256, 64);
+            backend.attach(fg);
+            fg_set_trace(fg, 64, callback_t(&clock, &TraceClock::now));
+
+            fg_open_pass(fg, "GBuffer", backend.pass());
+            FgTexture albedo = fg_write(fg, fg_create(fg, "albedo", &textures[0], &descrs[0]));
+            fg_close_pass(fg);
+
+            fg_final_pass(fg, "Resolve", backend.pass());
+            fg_read(fg, albedo);
+            fg_write(fg, fg_create(fg, "color", &textures[1], &descrs[1]));
+            fg_close_pass(fg);
+
+            fg_compile(fg, &graph_alloc);
+            fg_execute(fg, &ctxt);
+
+            FgTraceEvent events[64];
+            s32 const    count = fg_get_trace(fg, events, 64);
+#if FG_TRACE
+            // The 8 compile phases and fg_compile itself, create, access and execute of both passes and the destroy after
+            // 'Resolve', written when the scopes end
+            CHECK_EQUAL(9 + 7, count);
+            for (s32 i = 0; i < count; ++i)
+                CHECK_TRUE(events[i].m_end > events[i].m_begin);
+            CHECK_TRUE(TextOutput::equal("culling", events[0].m_name));
+            CHECK_TRUE(TextOutput::equal("fg_compile", events[8].m_name));
+
+            fg_export_trace(fg, callback_t(&output, &TextOutput::write), 10);
+            CHECK_TRUE(output.contains("{\"traceEvents\":[\n{\"name\":\"culling\",\"cat\":\"compile\",\"ph\":\"X\",\"ts\":"));
+            CHECK_TRUE(output.contains("{\"name\":\"Resolve\",\"cat\":\"execute\",\"ph\":\"X\""));
+            CHECK_TRUE(output.contains("\"dur\":1.000,\"pid\":0,\"tid\":0}"));
+            CHECK_TRUE(output.contains("}\n]}\n"));
+
+            // The ring keeps the most recent events
+            fg_set_trace(fg, 4, callback_t(&clock, &TraceClock::now));
+            fg_execute(fg, &ctxt);
+            CHECK_EQUAL(4, fg_get_trace(fg, events, 64));
+            CHECK_TRUE(TextOutput::equal("Resolve", events[3].m_name));
+            CHECK_TRUE(TextOutput::equal("destroy", events[3].m_category));
+            CHECK_TRUE(events[0].m_begin < events[3].m_begin);
+#else
+            CHECK_EQUAL(0, count);
+#endif
+
+            fg_teardown(fg);
+            Allocator->deallocate(graph_mem);
+        }
+
+        UNITTEST_TEST(Statistics)
+        {
+            MockBackend      backend;
+            GfxRenderContext ctxt;
+            TraceClock       clock = {0};
+
+            GfxTexture      backbuffer;
+            GfxTextureDescr backbufferDescr;
+            GfxTexture      textures[3];
+            GfxTextureDescr descrs[3];
+            GfxBuffer       buffer;
+            GfxBufferDescr  bufferDescr;
+            descrs[0].width  = 64;
+            descrs[0].height = 64;
+            descrs[1].width  = 32;
+            descrs[1].height = 32;
+            descrs[2].width  = 16;
+            descrs[2].height = 16;
+
+            u32 const      region_size = 1 * cMB;
+            void*          graph_mem   = Allocator->allocate(region_size);
+            linear_alloc_t graph_alloc;
+            graph_alloc.setup(graph_mem, region_size);
+
+            Fg* fg = fg_setup(&graph_alloc, 256, 64);
+            backend.attach(fg);
+            fg_set_memory_texture(fg, callback_t<void, GfxTextureDescr*, FgMemoryRequirements*>(MockBackend::memoryTexture));
+            fg_set_trace(fg, 0, callback_t(&clock, &TraceClock::now));
+
+            // A -> B -> D and A -> D, C is culled
+            FgTexture output = fg_import(fg, "backbuffer", &backbuffer, &backbufferDescr);
+
+            fg_open_pass(fg, "A", backend.pass());
+            FgTexture a = fg_write(fg, fg_create(fg, "a", &textures[0], &descrs[0]));
+            FgBuffer  b = fg_write(fg, fg_create(fg, "b", &buffer, &bufferDescr));
+            fg_close_pass(fg);
+
+            fg_open_pass(fg, "B", backend.pass());
+            fg_read(fg, a);
+            FgTexture c = fg_write(fg, fg_create(fg, "c", &textures[1], &descrs[1]));
+            fg_close_pass(fg);
+
+            fg_open_pass(fg, "C", backend.pass());
+            fg_write(fg, fg_create(fg, "d", &textures[2], &descrs[2]));
+            fg_close_pass(fg);
+
+            fg_final_pass(fg, "D", backend.pass());
+            fg_read(fg, c);
+            fg_read(fg, b);
+            fg_write(fg, output);
+            fg_close_pass(fg);
+
+            fg_compile(fg, &graph_alloc);
+            fg_execute(fg, &ctxt);
+
+            FgStats stats;
+            fg_get_stats(fg, &stats);
+            CHECK_EQUAL(4, stats.m_pass_count);
+            CHECK_EQUAL(1, stats.m_culled_count);
+            CHECK_EQUAL(3, stats.m_executed_count);
+            CHECK_EQUAL(6, stats.m_version_count); // the write of 'backbuffer' is a new version
+            CHECK_EQUAL(5, stats.m_physical_count);
+            CHECK_EQUAL(3, stats.m_created_count);
+            CHECK_EQUAL(3, stats.m_destroyed_count);
+            CHECK_EQUAL(3, stats.m_longest_chain);
+
+            // 'a', 'b' and 'c' are alive during B, the buffer has no memory requirements
+            CHECK_EQUAL(3, stats.m_peak_live);
+            CHECK_EQUAL((64 * 64 + 32 * 32) * 4, stats.m_peak_live_bytes);
+
+            // The clock is read when fg_compile begins and ends
+#if FG_TRACE
+            CHECK_EQUAL(10, stats.m_compile_ticks);
+#else
+            CHECK_EQUAL(0, stats.m_compile_ticks);
+#endif
+
+            fg_teardown(fg);
+            Allocator->deallocate(graph_mem);
+        }
+
+        UNITTEST_TEST(GraphExport)
+        {
+            MockBackend      backend;
+            GfxRenderContext ctxt;
+            TextOutput       dot;
+            TextOutput       json;
+            dot.m_size  = 0;
+            json.m_size = 0;
+
+            GfxTexture      backbuffer;
+            GfxTextureDescr backbufferDescr;
+            GfxTexture      textures[2];
+            GfxTextureDescr descrs[2];
+            descrs[0].width  = 64;
+            descrs[0].height = 64;
+            descrs[1].width  = 32;
+            descrs[1].height = 32;
+
+            u32 const      region_size = 1 * cMB;
+            void*          graph_mem   = Allocator->allocate(region_size);
+            linear_alloc_t graph_alloc;
+            graph_alloc.setup(graph_mem, region_size);
+
+            Fg* fg = fg_setup(&graph_alloc, 256, 64);
+            backend.attach(fg);
+            fg_set_memory_texture(fg, callback_t<void, GfxTextureDescr*, FgMemoryRequirements*>(MockBackend::memoryTexture));
+
+            FgFlags const write  = {1};
+            FgFlags const sample = {2};
+
+            // GBuffer -> Resolve, Debug is culled
+            FgTexture output = fg_import(fg, "backbuffer", &backbuffer, &backbufferDescr);
+
+            fg_open_pass(fg, "GBuffer", backend.pass());
+            FgTexture albedo = fg_write(fg, fg_create(fg, "albedo", &textures[0], &descrs[0]), write);
+            fg_close_pass(fg);
+
+            fg_open_pass(fg, "Debug", backend.pass());
+            fg_read(fg, albedo, sample);
+            fg_write(fg, fg_create(fg, "overlay", &textures[1], &descrs[1]));
+            fg_close_pass(fg);
+
+            fg_final_pass(fg, "Resolve", backend.pass());
+            fg_read(fg, albedo, sample);
+            fg_write(fg, output);
+            fg_close_pass(fg);
+
+            fg_compile(fg, &graph_alloc);
+
+            fg_export_dot(fg, callback_t(&dot, &TextOutput::write));
+            fg_export_json(fg, callback_t(&json, &TextOutput::write));
+            CHECK_TRUE(dot.contains("digraph framegraph\n{\n"));
+            CHECK_TRUE(dot.contains("p0 [shape=box, label=\"GBuffer\\n#0 queue 0\\nbarriers 1\"];"));
+            CHECK_TRUE(dot.contains("p1 [shape=box, style=dashed, color=gray, label=\"Debug\\nculled\"];"));
+            CHECK_TRUE(dot.contains("t1 [shape=ellipse, label=\"albedo\\nt1\\nlive #0..#1\\nheap 0 @ 0, 16384 bytes\"];"));
+            CHECK_TRUE(dot.contains("t3 [shape=ellipse, style=bold, label=\"backbuffer\\nt3 of t0\"];"));
+            CHECK_TRUE(dot.contains("p0 -> t1 [style=bold];\n    p1 -> t2 [style=bold];\n    t1 -> p1;\n"));
+            CHECK_TRUE(dot.contains("t1 -> p2;\n    t0 -> p2;\n    p2 -> t3;\n}\n"));
+
+            CHECK_TRUE(json.contains("{\"passes\":[\n{\"index\":0,\"name\":\"GBuffer\",\"culled\":false,\"position\":0,\"queue\":0,\"subpass\":-1,\"successors\":[2]"));
+            CHECK_TRUE(json.contains("{\"index\":1,\"name\":\"Debug\",\"culled\":true,\"position\":-1,"));
+            CHECK_TRUE(json.contains("\"reads\":[\"t1\",\"t0\"],\"writes\":[\"t3\"],\"releases\":[\"t1\"]"));
+            CHECK_TRUE(json.contains("\"transitions\":[{\"resource\":\"t1\",\"before\":1,\"after\":2,\"mip\":0,\"mip_count\":65535,\"slice\":0,\"slice_count\":65535,\"split\":false}"));
+            CHECK_TRUE(json.contains("{\"id\":\"t1\",\"name\":\"albedo\",\"root\":\"t1\",\"pass\":0,\"imported\":false,\"transient\":true,\"released\":2,\"heap\":0,\"offset\":0,\"size\":16384}"));
+            CHECK_TRUE(json.contains("{\"id\":\"t3\",\"name\":\"backbuffer\",\"root\":\"t0\",\"pass\":2,\"imported\":true,\"transient\":false}\n]}\n"));
+
+            fg_teardown(fg);
+            Allocator->deallocate(graph_mem);
+        }
+
+        UNITTEST_TEST(AliasingOutOfHeaps)
+        {
+            MockBackend backend;
+
+            GfxTexture      backbuffer;
+            GfxTextureDescr backbufferDescr;
+            GfxTexture      textures[70];
+            GfxTextureDescr descrs[70];
+
+            u32 const      region_size = 1 * cMB;
+            void*          graph_mem   = Allocator->allocate(region_size);
+            linear_alloc_t graph_alloc;
+            graph_alloc.setup(graph_mem, region_size);
+
+            Fg* fg = fg_setup(&graph_alloc, 256, 64);
+            backend.attach(fg);
+            fg_set_memory_texture(fg, callback_t<void, GfxTextureDescr*, FgMemoryRequirements*>(MockBackend::memoryTexture));
+            fg_set_heap_size(fg, 4);
+
+            // 70 transients of one heap each that are alive at the same time
+            FgTexture t[70];
+            fg_open_pass(fg, "A", backend.pass());
+            for (s32 i = 0; i < 70; ++i)
+                t[i] = fg_write(fg, fg_create(fg, "t", &textures[i], &descrs[i]));
+            fg_close_pass(fg);
+
+            fg_final_pass(fg, "B", backend.pass());
+            for (s32 i = 0; i < 70; ++i)
+                fg_read(fg, t[i]);
+            fg_write(fg, fg_import(fg, "backbuffer", &backbuffer, &backbufferDescr));
+            fg_close_pass(fg);
+
+            fg_compile(fg, &graph_alloc);
+
+            // The heaps run out, the remaining transients are not placed
+            CHECK_EQUAL(64, fg_get_heap_count(fg));
+            s32 placed = 0;
+            for (s32 i = 0; i < 70; ++i)
+                placed += fg_get_placement(fg, t[i]).m_heap >= 0 ? 1 : 0;
+            CHECK_EQUAL(64, placed);
+
+            fg_teardown(fg);
+            Allocator->deallocate(graph_mem);
+        }
+
+        UNITTEST_TEST(AccessStamps)
+        {
+            MockBackend      backend;
+            GfxRenderContext ctxt;
+
+            GfxTexture      backbuffer;
+            GfxTextureDescr backbufferDescr;
+            GfxTexture      texture;
+            GfxTextureDescr descr;
+            GfxBuffer       buffer;
+            GfxBufferDescr  bufferDescr;
+
+            u32 const      region_size = 1 * cMB;
+            void*          graph_mem   = Allocator->allocate(region_size);
+            linear_alloc_t graph_alloc;
+            graph_alloc.setup(graph_mem, region_size);
+
+            Fg* fg = fg_setup(&graph_alloc, 256, 64);
+            backend.attach(fg);
+
+            // Repeated accesses within a pass are recorded once, accesses of another pass are not affected by them
+            u64 hashes[2];
+            for (s32 frame = 0; frame < 2; ++frame)
+            {
+                bool const repeat = frame == 0;
+                fg_reset(fg);
+                FgTexture output = fg_import(fg, "backbuffer", &backbuffer, &backbufferDescr);
+
+                fg_open_pass(fg, "A", backend.pass());
+                FgTexture t = fg_create(fg, "t", &texture, &descr);
+                FgTexture w = fg_write(fg, t);
+                if (repeat)
+                    CHECK_EQUAL(w.index, fg_write(fg, t).index);
+                FgBuffer b = fg_write(fg, fg_create(fg, "b", &buffer, &bufferDescr));
+                if (repeat)
+                    CHECK_EQUAL(b.index, fg_write(fg, b).index);
+                fg_close_pass(fg);
+
+                fg_open_pass(fg, "B", backend.pass());
+                fg_read(fg, w);
+                fg_read(fg, b);
+                if (repeat)
+                {
+                    fg_read(fg, w);
+                    fg_read(fg, b);
+                }
+                fg_close_pass(fg);
+
+                fg_final_pass(fg, "C", backend.pass());
+                fg_read(fg, w);
+                fg_write(fg, output);
+                fg_close_pass(fg);
+
+                hashes[frame] = fg_get_structure_hash(fg);
+            }
+            CHECK_EQUAL(hashes[1], hashes[0]);
+
+            // The read of 'C' is recorded although 'B' read the same version, it keeps 'A' alive while 'B' is culled
+            fg_compile(fg, &graph_alloc);
+            fg_execute(fg, &ctxt);
+            CHECK_EQUAL(2, backend.m_executed);
+
+            fg_teardown(fg);
+            Allocator->deallocate(graph_mem);
+        }
+
+        UNITTEST_TEST(DownsampleChain)
+        {
+            GfxRenderContext  ctxt;
+            MockBackend       backend;
+            GfxRenderContext* worker_ctxts[] = {&ctxt};
+            ctxt.ref_count                   = 0;
+
+            GfxTexture      texture;
+            GfxTextureDescr descr;
+
+            s32 const   mips   = 12;
+            s32 const   finals = 16;
+            s32         cursor = 0;
+            OrderedPass passes[mips + finals];
+            for (s32 i = 0; i < mips + finals; ++i)
+                passes[i] = {&cursor, -1};
+
+            u32 const      region_size = 1 * cMB;
+            void*          graph_mem   = Allocator->allocate(region_size);
+            linear_alloc_t graph_alloc;
+            graph_alloc.setup(graph_mem, region_size);
+
+            Fg* fg = fg_setup(&graph_alloc, 64, 64);
+            backend.attach(fg);
+
+            // Every pass of the chain reads mip m-1 and writes mip m, each final pass reads all the mips written
+            // by different passes and so depends on every pass of the chain
+            fg_open_pass(fg, "Mip0", callback_t(&passes[0], &OrderedPass::execute));
+            FgTexture t = fg_write(fg, fg_create(fg, "chain", &texture, &descr), {1}, fg_mips(0));
+            fg_close_pass(fg);
+            for (s32 m = 1; m < mips; ++m)
+            {
+                fg_open_pass(fg, "Downsample", callback_t(&passes[m], &OrderedPass::execute));
+                fg_read(fg, t, {2}, fg_mips((u16)(m - 1)));
+                t = fg_write(fg, t, {1}, fg_mips((u16)m));
+                fg_close_pass(fg);
+            }
+            for (s32 i = 0; i < finals; ++i)
+            {
+                fg_final_pass(fg, "Final", callback_t(&passes[mips + i], &OrderedPass::execute));
+                fg_read(fg, t, {2});
+                fg_close_pass(fg);
+            }
+
+            fg_compile(fg, &graph_alloc);
+            fg_execute_parallel(fg, FgDispatchFn(dispatchSerial), worker_ctxts, 1);
+            CHECK_EQUAL(mips + finals, cursor);
+            for (s32 m = 1; m < mips; ++m)
+                CHECK_TRUE(passes[m].m_order > passes[m - 1].m_order);
+            for (s32 i = 0; i < finals; ++i)
+                CHECK_TRUE(passes[mips + i].m_order > passes[mips - 1].m_order);
+
+            // The same graph executed in order
+            fg_execute(fg, &ctxt);
+            CHECK_EQUAL(2 * (mips + finals), cursor);
+
+            fg_teardown(fg);
+            Allocator->deallocate(graph_mem);
+        }
+
+        struct TransitionCounter
+        {
+            s32 m_count;
+
+            void record(GfxRenderContext* ctxt, FgTransition const* transitions, s32 count) { m_count += count; }
+        };
+
+        UNITTEST_TEST(FragmentedSubresources)
+        {
+            GfxRenderContext  ctxt;
+            MockBackend       backend;
+            TransitionCounter transitions     = {0};
+            GfxRenderContext* worker_ctxts[] = {&ctxt};
+            ctxt.ref_count                   = 0;
+
+            GfxTexture      texture;
+            GfxTextureDescr descr;
+
+            s32 const   slices = 32;
+            s32 const   mips   = 16;
+            s32         cursor = 0;
+            OrderedPass passes[slices + mips];
+            for (s32 i = 0; i < slices + mips; ++i)
+                passes[i] = {&cursor, -1};
+
+            u32 const      region_size = 1 * cMB;
+            void*          graph_mem   = Allocator->allocate(region_size);
+            linear_alloc_t graph_alloc;
+            graph_alloc.setup(graph_mem, region_size);
+
+            // Capacities that just fit the accesses, the edges and transitions outgrow the storage of fg_setup
+            Fg* fg = fg_setup(&graph_alloc, 48, 64);
+            backend.attach(fg);
+            fg_set_transitions(fg, callback_t(&transitions, &TransitionCounter::record));
+
+            // Every slice is written by its own pass, then every pass that reads a mip of all the slices depends on
+            // all of them and transitions the mip in each slice
+            FgTexture t;
+            for (s32 s = 0; s < slices; ++s)
+            {
+                fg_open_pass(fg, "Slice", callback_t(&passes[s], &OrderedPass::execute));
+                t = fg_write(fg, s == 0 ? fg_create(fg, "array", &texture, &descr) : t, {1}, fg_slices((u16)s));
+                fg_close_pass(fg);
+            }
+            for (s32 m = 0; m < mips; ++m)
+            {
+                fg_final_pass(fg, "Mip", callback_t(&passes[slices + m], &OrderedPass::execute));
+                fg_read(fg, t, {2}, fg_mips((u16)m));
+                fg_close_pass(fg);
+            }
+
+            fg_compile(fg, &graph_alloc);
+            fg_execute_parallel(fg, FgDispatchFn(dispatchSerial), worker_ctxts, 1);
+            CHECK_EQUAL(slices + mips, cursor);
+            for (s32 m = 0; m < mips; ++m)
+            {
+                for (s32 s = 0; s < slices; ++s)
+                    CHECK_TRUE(passes[slices + m].m_order > passes[s].m_order);
+            }
+
+            // A mip also transitions the slices past the written ones, which have not been accessed before
+            CHECK_EQUAL(slices + (slices + 1) * mips, transitions.m_count);
+
+            fg_teardown(fg);
+            Allocator->deallocate(graph_mem);
+        }
+
+        // A job system that runs every worker on a thread of its own
+        static void dispatchThreads(FgWorkerFn worker, s32 worker_count)
+        {
+            std::thread threads[8];
+            for (s32 i = 0; i < worker_count; ++i)
+                threads[i] = std::thread([worker, i]() { worker.Call(i); });
+            for (s32 i = 0; i < worker_count; ++i)
+                threads[i].join();
+        }
+
+        // Records when a pass begins and ends on a clock shared by the workers
+        struct TimedPass
+        {
+            std::atomic<s32>* m_clock;
+            s32               m_begin;
+            s32               m_end;
+
+            void execute(Fg* fg, GfxRenderContext* ctxt)
+            {
+                m_begin = m_clock->fetch_add(1);
+                std::this_thread::yield();
+                m_end = m_clock->fetch_add(1);
+                ctxt->ref_count += 1;
+            }
+        };
+
+        UNITTEST_TEST(ParallelThreads)
+        {
+            u32 const      region_size = 1 * cMB;
+            void*          graph_mem   = Allocator->allocate(region_size);
+            linear_alloc_t graph_alloc;
+            graph_alloc.setup(graph_mem, region_size);
+
+            s32 const         branches = 8;
+            MockBackend       backend;
+            GfxRenderContext  ctxts[4];
+            GfxRenderContext* worker_ctxts[4];
+            for (s32 i = 0; i < 4; ++i)
+                worker_ctxts[i] = &ctxts[i];
+
+            GfxTexture      textures[branches];
+            GfxTextureDescr descrs[branches];
+            for (s32 i = 0; i < branches; ++i)
+            {
+                descrs[i].width  = 16;
+                descrs[i].height = 16;
+            }
+
+            std::atomic<s32> clock(0);
+            TimedPass        passes[2 * branches];
+
+            Fg* fg = fg_setup(&graph_alloc, 64, 64);
+            backend.attach(fg);
+            fg_set_memory_texture(fg, callback_t<void, GfxTextureDescr*, FgMemoryRequirements*>(MockBackend::memoryTexture));
+
+            // Independent branches, each one writes a transient and reads it in a final pass. Executed in order their
+            // lifetimes do not overlap and the transients share the same memory, the workers have to follow that order.
+            for (s32 frame = 0; frame < 16; ++frame)
+            {
+                for (s32 i = 0; i < 2 * branches; ++i)
+                    passes[i] = {&clock, -1, -1};
+                for (s32 i = 0; i < 4; ++i)
+                    ctxts[i].ref_count = 0;
+
+                FgTexture t[branches];
+                for (s32 b = 0; b < branches; ++b)
+                {
+                    fg_open_pass(fg, "Write", callback_t(&passes[2 * b], &TimedPass::execute));
+                    t[b] = fg_write(fg, fg_create(fg, "t", &textures[b], &descrs[b]));
+                    fg_close_pass(fg);
+                    fg_final_pass(fg, "Read", callback_t(&passes[2 * b + 1], &TimedPass::execute));
+                    fg_read(fg, t[b]);
+                    fg_close_pass(fg);
+                }
+
+                fg_compile(fg, &graph_alloc);
+                fg_execute_parallel(fg, FgDispatchFn(dispatchThreads), worker_ctxts, 4);
+
+                CHECK_EQUAL(1, fg_get_heap_count(fg));
+                for (s32 b = 0; b < branches; ++b)
+                {
+                    CHECK_EQUAL(0, fg_get_placement(fg, t[b]).m_offset);
+                    CHECK_TRUE(passes[2 * b + 1].m_begin > passes[2 * b].m_end);
+                    if (b > 0)
+                        CHECK_TRUE(passes[2 * b].m_begin > passes[2 * b - 1].m_end);
+                }
+                CHECK_EQUAL(2 * branches, ctxts[0].ref_count + ctxts[1].ref_count + ctxts[2].ref_count + ctxts[3].ref_count);
+                fg_reset(fg);
+            }
+            CHECK_EQUAL(16 * branches, backend.m_textures_created);
+            CHECK_EQUAL(16 * branches, backend.m_textures_destroyed);
+
+            fg_teardown(fg);
+            Allocator->deallocate(graph_mem);
+        }
     }
 }